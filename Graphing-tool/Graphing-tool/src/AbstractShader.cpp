@@ -1,49 +1,137 @@
 #include "AbstractShader.h"
 
+#include <GLFW/glfw3.h>
+
+#include "ProgramCache.h"
+
+// GL_KHR_parallel_shader_compile is not part of the generated loader
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
 
 void AbstractShader::use()
 {
 	glUseProgram(ID);
 }
 
+unsigned long long AbstractShader::lookupsAvoided = 0;
+
+// Names of the Uniform values in the shaders, in the same order
+static const char* uniformNames[(int)Uniform::Count] = {
+	"scale", "graphWidth", "size", "offset", "center", "model", "color", "edges", "surface", "edgeMode", "strips",
+	"spacing", "firstTileX", "firstTileZ", "tileCountX", "tileCountZ", "layerStride"
+};
+
+int AbstractShader::getUniformLocation(const std::string& name) const
+{
+	std::unordered_map<std::string, int>::const_iterator location = uniformLocations.find(name);
+	return location != uniformLocations.end() ? location->second : -1;
+}
+
+int AbstractShader::getUniformLocation(Uniform uniform) const
+{
+	lookupsAvoided++;
+	return resolvedLocations[(int)uniform];
+}
+
+unsigned long long AbstractShader::getLookupsAvoided()
+{
+	return lookupsAvoided;
+}
+
+bool AbstractShader::supportsParallelCompile()
+{
+	// Checked once, with the first context
+	static int supported = -1;
+	if (supported == -1)
+	{
+		supported = glfwExtensionSupported("GL_KHR_parallel_shader_compile") || glfwExtensionSupported("GL_ARB_parallel_shader_compile");
+		if (supported)
+		{
+			// Letting the driver use as many compiler threads as it likes
+			PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+				(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+			if (maxShaderCompilerThreads == NULL)
+				maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+			if (maxShaderCompilerThreads != NULL)
+				maxShaderCompilerThreads(0xFFFFFFFF);
+		}
+	}
+	return supported == 1;
+}
+
+bool AbstractShader::isLinkComplete() const
+{
+	if (!supportsParallelCompile())
+		return true;
+
+	int complete = 0;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete != 0;
+}
+
 void AbstractShader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	glUniform1i(getUniformLocation(name), (int)value);
 }
 void AbstractShader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1f(getUniformLocation(name), value);
 }
 void AbstractShader::setDouble(const std::string& name, double value) const
 {
-	glUniform1d(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1d(getUniformLocation(name), value);
 }
 void AbstractShader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1i(getUniformLocation(name), value);
 }
 void AbstractShader::setVector2(const std::string& name, float v1, float v2) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), v1, v2);
+	glUniform2f(getUniformLocation(name), v1, v2);
 }
 void AbstractShader::setVector2(const std::string& name, glm::vec2 v) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), v.x, v.y);
+	glUniform2f(getUniformLocation(name), v.x, v.y);
 }
 void AbstractShader::setVector3(const std::string& name, float v1, float v2, float v3) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), v1, v2, v3);
+	glUniform3f(getUniformLocation(name), v1, v2, v3);
 }
 void AbstractShader::setVector3(const std::string& name, glm::vec3 v) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), v.x, v.y, v.z);
+	glUniform3f(getUniformLocation(name), v.x, v.y, v.z);
 }
 void AbstractShader::setMat4(const std::string& name, glm::mat4 matrix) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix));
+	glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
-unsigned int AbstractShader::compileShader(GLenum type, const char* code)
+void AbstractShader::setBool(Uniform uniform, bool value) const
+{
+	glUniform1i(getUniformLocation(uniform), (int)value);
+}
+void AbstractShader::setFloat(Uniform uniform, float value) const
+{
+	glUniform1f(getUniformLocation(uniform), value);
+}
+void AbstractShader::setInt(Uniform uniform, int value) const
+{
+	glUniform1i(getUniformLocation(uniform), value);
+}
+void AbstractShader::setVector2(Uniform uniform, glm::vec2 v) const
+{
+	glUniform2f(getUniformLocation(uniform), v.x, v.y);
+}
+void AbstractShader::setVector3(Uniform uniform, float v1, float v2, float v3) const
+{
+	glUniform3f(getUniformLocation(uniform), v1, v2, v3);
+}
+void AbstractShader::setMat4(Uniform uniform, glm::mat4 matrix) const
+{
+	glUniformMatrix4fv(getUniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+unsigned int AbstractShader::compileShader(GLenum type, const char* code, bool checkStatus)
 {
 	unsigned int id;
 	int success;
@@ -52,6 +140,9 @@ unsigned int AbstractShader::compileShader(GLenum type, const char* code)
 	id = glCreateShader(type);
 	glShaderSource(id, 1, &code, NULL);
 	glCompileShader(id);
+	if (!checkStatus)
+		return id;
+
 	// Printing errors:
 	glGetShaderiv(id, GL_COMPILE_STATUS, &success);
 	if (!success)
@@ -104,12 +195,56 @@ std::string AbstractShader::readFile(const char* shaderPath)
 	return shaderCode;
 }
 
+std::string AbstractShader::functionToGLSL(const std::string& function, bool throwError)
+{
+	try
+	{
+		Expression expression(function);
+		return expression.toGLSL();
+	}
+	catch (const ExpressionError& e)
+	{
+		if (throwError)
+		{
+			throw;
+		}
+		std::cout << "Error: invalid function.\n" << e.what() << std::endl;
+		return "0.0";
+	}
+}
+
+bool AbstractShader::loadCachedProgram(const std::string& functionCode, const std::string& templateCode)
+{
+	ProgramCache& cache = ProgramCache::getInstance();
+	if (!cache.isEnabled())
+		return false;
+
+	std::string key = cache.getKey(functionCode, templateCode);
+	if (cache.load(key, ID))
+		return true;
+
+	// The binary can only be retrieved if the driver is told before linking
+	glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	binaryCacheKey = key;
+	return false;
+}
+
 void AbstractShader::linkProgram(bool throwError)
+{
+	startLink();
+	finishLink(throwError);
+}
+
+void AbstractShader::startLink()
+{
+	glLinkProgram(ID);
+}
+
+void AbstractShader::finishLink(bool throwError)
 {
 	int success;
 	char infoLog[512];
 
-	glLinkProgram(ID);
 	// Print linking errors if any
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);
 	if (!success)
@@ -125,4 +260,42 @@ void AbstractShader::linkProgram(bool throwError)
 			return;
 		}
 	}
+
+	// Storing the binary of a newly compiled program, so it never has to be compiled again
+	if (!binaryCacheKey.empty())
+	{
+		ProgramCache::getInstance().store(binaryCacheKey, ID);
+		binaryCacheKey.clear();
+	}
+
+	// Caching the location of every active uniform, so setting them never asks the driver
+	uniformLocations.clear();
+	int uniformCount = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	for (int i = 0; i < uniformCount; i++)
+	{
+		char name[256];
+		int length = 0, arraySize = 0;
+		GLenum type;
+		glGetActiveUniform(ID, i, sizeof(name), &length, &arraySize, &type, name);
+
+		// Uniforms in blocks have no location
+		int location = glGetUniformLocation(ID, name);
+		if (location == -1)
+			continue;
+		std::string uniformName(name, length);
+		uniformLocations[uniformName] = location;
+
+		// Arrays are reported as name[0], but can also be set by their name
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+		{
+			uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+		}
+	}
+
+	// Resolving the uniforms of the hot paths once, so updating them needs no lookup at all
+	for (int i = 0; i < (int)Uniform::Count; i++)
+	{
+		resolvedLocations[i] = getUniformLocation(uniformNames[i]);
+	}
 }
@@ -2,16 +2,44 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+
+#include "Expression.h"
 
 // Matrix math
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Uniforms set on every calculation or draw, their locations are resolved once when the program links.
+// Uniforms a program does not have (or that are optimised out) are ignored.
+enum class Uniform
+{
+	Scale,
+	GraphWidth,
+	Size,
+	Offset,
+	Center,
+	Model,
+	Color,
+	Edges,
+	Surface,
+	EdgeMode,
+	Strips,
+	Spacing,
+	FirstTileX,
+	FirstTileZ,
+	TileCountX,
+	TileCountZ,
+	LayerStride,
+	Count
+};
+
 class AbstractShader
 {
 public:
@@ -21,7 +49,8 @@ public:
 	// Activates the shader
 	void use();
 
-	// Uniform setting functions
+	// Uniform setting functions, the name versions look the location up in the cache,
+	// the Uniform versions use the location resolved at link time
 	void setBool(const std::string& name, bool value) const;
 	void setFloat(const std::string& name, float value) const;
 	void setDouble(const std::string& name, double value) const;
@@ -32,13 +61,59 @@ public:
 	void setVector3(const std::string& name, glm::vec3 v) const;
 	void setMat4(const std::string& name, glm::mat4 matrix) const;
 
+	void setBool(Uniform uniform, bool value) const;
+	void setFloat(Uniform uniform, float value) const;
+	void setInt(Uniform uniform, int value) const;
+	void setVector2(Uniform uniform, glm::vec2 v) const;
+	void setVector3(Uniform uniform, float v1, float v2, float v3) const;
+	void setMat4(Uniform uniform, glm::mat4 matrix) const;
+
+	// Get the number of uniform updates that used a resolved location instead of looking the name up, over all shaders
+	static unsigned long long getLookupsAvoided();
+
+	// Whether the driver compiles and links programs in the background (GL_KHR_parallel_shader_compile)
+	static bool supportsParallelCompile();
+	// Whether a program whose link was started has finished linking.
+	// Never waits with parallel compiling, without it linking is always reported as complete.
+	bool isLinkComplete() const;
+	// Check the link status of a program whose link was started and fill the uniform location cache
+	void finishLink(bool throwError);
+
 protected:
-	unsigned int compileShader(GLenum type, const char* code);
+	// Without checkStatus errors only show up when linking, which lets the driver compile in the background
+	unsigned int compileShader(GLenum type, const char* code, bool checkStatus = true);
 	bool replace(std::string& str, const std::string& from, const std::string& to);
 	std::string readFile(const char* shaderPath);
+	// Parse the user function and generate the GLSL code that calculates it.
+	// Invalid functions throw an ExpressionError if throwError is set, and are replaced by 0 otherwise.
+	std::string functionToGLSL(const std::string& function, bool throwError);
+	// Links the program and fills the uniform location cache
 	void linkProgram(bool throwError);
+	// Start linking the program without waiting for the result, finish it with finishLink
+	void startLink();
+
+	// Load the program from the program binary cache, returns false if it has to be compiled.
+	// On a miss the program is prepared so its binary is stored once it is linked.
+	bool loadCachedProgram(const std::string& functionCode, const std::string& templateCode);
+
+	// Key the binary is stored under once the program is linked, empty if it should not be stored
+	std::string binaryCacheKey;
+
+	// Locations of all active uniforms, by name
+	std::unordered_map<std::string, int> uniformLocations;
+	// Locations of the Uniform values, -1 for those the program does not have
+	int resolvedLocations[(int)Uniform::Count];
+	static unsigned long long lookupsAvoided;
+
+	// Get the location of a uniform by name, -1 if the program does not have it
+	int getUniformLocation(const std::string& name) const;
+	// Get the resolved location of a uniform, counting the avoided lookup
+	int getUniformLocation(Uniform uniform) const;
 
 	// Cannot be instantiated
-	AbstractShader() {}
+	AbstractShader()
+	{
+		std::fill(resolvedLocations, resolvedLocations + (int)Uniform::Count, -1);
+	}
 	~AbstractShader() {}
 };
\ No newline at end of file
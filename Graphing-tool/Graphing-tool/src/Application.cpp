@@ -1,6 +1,16 @@
 #include "Application.h"
 #include <chrono>         // std::chrono::seconds
 #include <thread>         // std::this_thread::sleep_for
+#include <iomanip>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+
+#include "SimdMath.h"
+#include "ImageWriter.h"
+#include "WorkgroupTuner.h"
+#include "ProgramCache.h"
+#include "VariableBaker.h"
 
 Application::Application(const int width, const int height, std::string function)
 	: WIDTH(width), HEIGHT(height),
@@ -42,6 +52,9 @@ int Application::Start()
 	// Setup Dear ImGui style to be dark
 	ImGui::StyleColorsDark();
 
+	// Counting events to know when to render, installed first so the ImGui backend passes events on to them
+	Callbacks::installEventCallbacks(window);
+
 	// Setup Platform/Renderer backends
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	ImGui_ImplOpenGL3_Init("#version 130");
@@ -52,6 +65,15 @@ int Application::Start()
 	// Creating a window and making things be rendered in correct order
 	glViewport(0, 0, WIDTH, HEIGHT);
 	glEnable(GL_DEPTH_TEST);
+	frameUniforms.create();
+	// Enabling background shader compiling before any shader is compiled
+	AbstractShader::supportsParallelCompile();
+	// Timestamp queries are core since OpenGL 3.3
+	if (GLAD_GL_VERSION_3_3)
+	{
+		profiler.create();
+		frameStats.create();
+	}
 
 	// Setting the callback for window resizing
 	Callbacks& callbacks = Callbacks::getInstance();
@@ -60,32 +82,47 @@ int Application::Start()
 	// Callback for window size changed
 	glfwSetFramebufferSizeCallback(window, &Callbacks::framebuffer_size_callback);
 	
+	// Finding the fastest compute workgroup size for this device, on the largest grid
+	if (GLAD_GL_VERSION_4_3)
+	{
+		WorkgroupTuner tuner(function, details[3]);
+		workgroupSize = tuner.getBestSize();
+		workgroupReport = tuner.getReport();
+	}
+
 	// Importing and compiling the shaders
 	//Shader shader("./src/shaders/vertexShader.shader", "./src/shaders/fragmentShader.shader");
 	Shader shader("src/shaders/vertexShader.shader", "src/shaders/fragmentShader.shader");
 	Shader calculatorShader(function, "src/shaders/calculatorVertexShader.shader", "src/shaders/calculatorFragmentShader.shader", false);
-	ComputeShader meshGeneratorShader("src/shaders/meshGenerator.shader");
-	ComputeShader calculatorComputeShader(function, "src/shaders/calculatorComputeShader.shader", false);
+	Shader pullingShader("src/shaders/calculatorPullingVertexShader.shader", "src/shaders/calculatorFragmentShader.shader");
+	Shader lodShader("src/shaders/lodVertexShader.shader", "src/shaders/calculatorFragmentShader.shader");
+	ComputeShader meshGeneratorShader("src/shaders/meshGenerator.shader", workgroupSize);
+	ComputeShader calculatorComputeShader(function, "src/shaders/calculatorComputeShader.shader", false, workgroupSize);
+
+	// The CPU calculates the heights when chosen in the GUI
+	cpuEvaluator.setFunction(function);
+
+	// The variables of the function, uploaded before the first calculation
+	variableHandler.setFunction(function);
+	variableHandler.uploadVariables();
+	heightCache.setFunction(function);
+	tiledDomain.setFunction(function);
+	lodTerrain.setFunction(function);
 
 	// Creating our mesh
 	generateGridMesh(&meshGeneratorShader, &calculatorComputeShader);
 
-	// Will handle user variables
-	VariableHandler variableHandler;
-
 	// Creating a VAO for the axes
 	unsigned int axesVAO = generateAxesVAO();
 
 
 	// ImGui state
 	std::string functionInput{ function };
-	variableHandler.setFunction(functionInput);
 
 	float timeSinceGuiSwitch = 10.0f;
 
 	int detailLevel = 1;
 	int previousDetailLevel = 1;
-	int details[4] = { 100, 400, 900, 1600 };
 
 	// Custom settings
 	float verticalScale = 1.0f;
@@ -98,34 +135,159 @@ int Application::Start()
 	
 	bool autoUpdate = true;
 	bool updateMesh = false;
+	// GPU calculations in total, and those that finished while the CPU built the GUI
+	unsigned int gpuCalculations = 0;
+	unsigned int overlappedCalculations = 0;
 
 	// Function input error log
 	bool functionError = false;
 	bool additionalFunctionErrorInfo = false;
 	std::string functionErrorMessage = "";
+	// Parse error of the function currently being typed
+	std::string functionInputError = "";
+
+	// Calculator shader of a new function, linked in the background while the old one keeps rendering
+	std::unique_ptr<ComputeShader> pendingComputeShader;
+	std::string pendingFunction;
+	double compileStartTime = 0.0;
+	std::string compileStatus;
+
+	// Versions of the calculator shader with unchanging variables compiled in as constants
+	VariableBaker variableBaker;
+	variableBaker.setFunction(function);
+	bool bakeVariables = false;
+
+	// Parameter sweep state: the step that is shown, and playing through the steps over a duration
+	variableSweep.setFunction(function);
+	int sweepSteps = (int)variableSweep.getStepCount();
+	bool showSweep = false;
+	bool playSweep = false;
+	float sweepDuration = 4.0f;
+	int sweepStep = 0;
+
+	// Height cache settings, budgets in megabytes
+	bool cacheHeights = heightCache.isEnabled();
+	int gpuCacheBudget = (int)(heightCache.getGpuBudget() / (1024 * 1024));
+	int cpuCacheBudget = (int)(heightCache.getCpuBudget() / (1024 * 1024));
+	bool tiledHeights = tiledDomain.isEnabled();
+
+	// Level of detail settings
+	bool adaptiveDetail = lodTerrain.isEnabled();
+	int lodLevel = lodTerrain.getMaxLevel();
+	float lodDistance = lodTerrain.getDetailDistance();
 
 	// Color customisation
 	ImVec4 clearColor(0.09f, 0.05f, 0.11f, 1.0f);
 	ImVec4 upperColor(0.0f, 0.0f, 1.0f, 1.0f);
 	ImVec4 lowerColor(1.0f, 0.0f, 0.0f, 1.0f);
 
+	// Rendering settings
+	bool renderOnDemand = true;
+	bool vsync = true;
+	int frameCap = 0;
+	glfwSwapInterval(1);
+
+	// Frames rendered after the last change, ImGui needs a few frames to settle (hover, animations)
+	const int settleFrames = 3;
+	// Longest wait for input in seconds
+	const double idleTimeout = 0.5;
+	int unchangedFrames = 0;
+	unsigned int renderedFrames = 0;
+
 	// Render loop: runs while the window does not close
 	while (!glfwWindowShouldClose(window))
 	{
+		// Waiting for input when nothing changed, instead of drawing the same frame again
+		if (renderOnDemand && unchangedFrames >= settleFrames)
+		{
+			unsigned int eventCount = Callbacks::getEventCount();
+			glfwWaitEventsTimeout(idleTimeout);
+			if (eventCount == Callbacks::getEventCount())
+				continue;
+
+			// The time spent waiting is no frame time, otherwise the camera would jump
+			lastFrame = glfwGetTime();
+			frameStats.pause();
+			unchangedFrames = 0;
+		}
+
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		profiler.beginFrame();
+		frameStats.beginFrame();
+		unsigned int frameCalculations = calculationCount;
+		unsigned int frameEvents = Callbacks::getEventCount();
+		glm::vec3 framePosition = camera.getPosition();
+		float framePitch = camera.getPitch();
+		float frameYaw = camera.getYaw();
+
 		// Checking for event input
+		profiler.beginCpu("Input");
 		glfwPollEvents();
+		profiler.endCpu();
 
 		// Calculating the heights (does not run if no important variables changed)
 		bool updatedData = false;
-		if (autoUpdate) {
-			// Setting the user variables
-			variableHandler.setVariables(&calculatorComputeShader);
-			// Only force update if a variable has changed
-			updatedData = calculate(&calculatorComputeShader, heightsSSBO, variableHandler.variableChanged());
+
+		// Switching to the new function once its shader is linked, this never waits with parallel compiling
+		if (pendingComputeShader && pendingComputeShader->isLinkComplete())
+		{
+			try
+			{
+				pendingComputeShader->finishLink(true);
+				glDeleteProgram(calculatorComputeShader.ID);
+				calculatorComputeShader = *pendingComputeShader;
+				cpuEvaluator.setFunction(pendingFunction);
+				variableBaker.setFunction(pendingFunction);
+				variableSweep.setFunction(pendingFunction);
+				heightCache.setFunction(pendingFunction);
+				tiledDomain.setFunction(pendingFunction);
+				lodTerrain.setFunction(pendingFunction);
+				// The new function may have other variables, in another order
+				variableHandler.setFunction(pendingFunction);
+				variableHandler.uploadVariables();
+				updatedData = calculate(&calculatorComputeShader, true);
+
+				compileStatus = "Compiled in " + std::to_string((int)((glfwGetTime() - compileStartTime) * 1000.0)) + " ms";
+			}
+			catch (const std::exception& e)
+			{
+				glDeleteProgram(pendingComputeShader->ID);
+				functionError = true;
+				// Convert to string in order to preserve it
+				functionErrorMessage = std::string(e.what());
+				compileStatus = "";
+			}
+			pendingComputeShader.reset();
+		}
+
+		// The baked version is only used while the variables keep the values it was baked with
+		variableBaker.update(variableHandler.getValues(), workgroupSize);
+		ComputeShader* activeComputeShader = variableBaker.getShader(variableHandler.getValues());
+		if (activeComputeShader == nullptr)
+			activeComputeShader = &calculatorComputeShader;
+
+		// A calculated sweep is drawn instead of calculating, the variables follow its current step
+		bool sweepShown = showSweep && variableSweep.isCalculated(size, scale, graphWidth, center);
+		if (sweepShown)
+		{
+			if (playSweep)
+				sweepStep = (int)(std::fmod(glfwGetTime(), (double)sweepDuration) / sweepDuration * variableSweep.getCalculatedSteps());
+			sweepStep = std::min(sweepStep, (int)variableSweep.getCalculatedSteps() - 1);
+
+			const float* stepValues = variableSweep.getStepValues(sweepStep);
+			const std::vector<std::string>& names = variableHandler.getNames();
+			for (size_t i = 0; i < names.size(); i++)
+			{
+				variableHandler.setValue(names[i], stepValues[i]);
+			}
+		}
+
+		if (autoUpdate && !sweepShown) {
+			// Uploading the changed user variables, only force update if a variable has changed
+			updatedData = calculate(activeComputeShader, variableHandler.uploadVariables());
 		}
 
 
@@ -166,71 +328,10 @@ int Application::Start()
 		}
 		guiSwitchKeyPreviousState = glfwGetKey(window, GLFW_KEY_R);
 		
-		/* RENDERING */
-		
-		// Drawing background
-		glClearColor(clearColor.x * clearColor.w, clearColor.y * clearColor.w, clearColor.z * clearColor.w, clearColor.w);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		
-		// Drawing axes
-		drawAxes(axesVAO, &shader, &camera);
-		
-		// Binding the shader program
-		calculatorShader.use();
-		
-		// Setting uniforms
-		float time = glfwGetTime();
-
-		calculatorShader.setFloat("graphWidth", generatedGraphWidth);
-		calculatorShader.setFloat("verticalScale", verticalScale);
-		calculatorShader.setVector3("upperColor", imGuiVec4ToGlmVec3(upperColor));
-		calculatorShader.setVector3("lowerColor", imGuiVec4ToGlmVec3(lowerColor));
-
-		// Model matrix
-		glm::mat4 model = glm::mat4(1.0f);
-		calculatorShader.setMat4("model", model);
-		
-		// View matrix
-		glm::mat4 view = glm::mat4(1.0f);
-		view = camera.getViewMatrix();
-		calculatorShader.setMat4("view", view);
-		
-		// Projection matrix
-		glm::mat4 projection;
-		projection = camera.getProjectionMatrix(WIDTH, HEIGHT);
-		calculatorShader.setMat4("projection", projection);
-
+		/* GUI */
 
-		// Binding vertex array
-		glBindVertexArray(VAO);
-
-		// Binding the VAO if not in wireframe mode
-		if (!wireframe)
-		{
-			// Drawing with colour
-			calculatorShader.setBool("edgeMode", false);
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glDrawElements(GL_TRIANGLES, (size - 1) * (size - 1) * 6, GL_UNSIGNED_INT /* index type */, 0);
-		}
-		
-		// Drawing edges if not in 'smooth' mode
-		if (!smoothMesh || wireframe)
-		{
-			calculatorShader.setBool("edgeMode", true);
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			glLineWidth(1.0f);
-			glDrawElements(GL_TRIANGLES, (size - 1) * (size - 1) * 6, GL_UNSIGNED_INT /* index type */, 0);
-		}
-
-		calculatorShader.setFloat("offset", 2.0f / (float)(size - 1.0f));
-		calculatorShader.setInt("size", size);
-
-		// Unbinding vertex array
-		glBindVertexArray(0);
-
-
-		/* FINALIZING */
-		
+		// Building the GUI before drawing, so the CPU is busy with it while the GPU calculates the heights.
+		profiler.beginCpu("Build GUI");
 		// Start the Dear ImGui frame
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -243,20 +344,44 @@ int Application::Start()
 		
 			ImGui::Text("Press R to return to graph view, \nwhere you can look around.");
 
-			ImGui::InputText("Function", &functionInput);
+			if (ImGui::InputText("Function", &functionInput))
+			{
+				// Validating on every keystroke: parsing is cheap and never touches the driver
+				try
+				{
+					Expression expression(functionInput);
+					functionInputError = "";
+				}
+				catch (const ExpressionError& e)
+				{
+					functionInputError = std::string(e.what());
+				}
+			}
+			// Showing the parse error of the current input, if any
+			if (!functionInputError.empty())
+			{
+				ImGui::TextColored(ImVec4(0.8f, 0.15f, 0.15f, 1.0f), "%s", functionInputError.c_str());
+			}
 			if (ImGui::Button("Set function"))
 			{
 				try
 				{
-					// Re-compiling calculator shader with new function
-					ComputeShader _calculatorComputeShader(functionInput, "src/shaders/calculatorComputeShader.shader", false);
-					calculatorComputeShader = _calculatorComputeShader;
-					// Setting the user variables
-					variableHandler.setVariables(&calculatorComputeShader);
-					updatedData = calculate(&calculatorComputeShader, heightsSSBO, true);
-					variableHandler.setFunction(functionInput);
+					// Re-compiling calculator shader with new function (invalid functions throw before compiling).
+					// Linking finishes in the background, the current function is drawn until then.
+					std::unique_ptr<ComputeShader> compiling(new ComputeShader(functionInput, "src/shaders/calculatorComputeShader.shader", true, workgroupSize, true));
+					// A newer function replaces one that is still compiling
+					if (pendingComputeShader)
+						glDeleteProgram(pendingComputeShader->ID);
+					pendingComputeShader = std::move(compiling);
+					pendingFunction = functionInput;
+					compileStartTime = glfwGetTime();
 				}
-				catch (std::exception e)
+				catch (const ExpressionError& e)
+				{
+					functionError = true;
+					functionErrorMessage = std::string(e.what());
+				}
+				catch (const std::exception& e)
 				{
 					functionError = true;
 					// Convert to string in order to preserve it
@@ -264,6 +389,17 @@ int Application::Start()
 				}
 			}
 
+			// Status of the background compile
+			if (pendingComputeShader)
+			{
+				ImGui::Text("Compiling... %.1f s", glfwGetTime() - compileStartTime);
+			}
+			else if (!compileStatus.empty())
+			{
+				ImGui::Text("%s%s", compileStatus.c_str(),
+					AbstractShader::supportsParallelCompile() ? "" : " (the driver does not compile in the background)");
+			}
+
 			// Function error
 			if (functionError)
 			{
@@ -316,7 +452,7 @@ int Application::Start()
 				ImGui::Separator();
 
 				ImGui::BulletText("Use variables x and z for inputs.");
-				ImGui::BulletText("Use letters 'a' to 'f' to denote user variables.\nWhen you include any of these in your function,\nthey will show up above.\nThen click and drag the variable value to change it.");
+				ImGui::BulletText("Any other name, like a or speed, is a user variable.\nWhen you include any in your function,\nthey will show up above.\nThen click and drag the variable value to change it.");
 				ImGui::BulletText("x is represented by the red axis, z by the blue axis.");
 				ImGui::BulletText("All trigonometric functions \ntake radians as input/output.");
 
@@ -330,6 +466,7 @@ int Application::Start()
 			ImGui::SliderFloat("Scale", &scale, 0.1f, 10.0f);
 			ImGui::SliderFloat("Vertical scale", &verticalScale, 0.1f, 10.0f);
 			ImGui::SliderFloat("Graph width", &graphWidth, 0.1f, 10.0f);
+			ImGui::DragFloat2("Center", &center.x, 0.05f * scale);
 
 			if (ImGui::Button(smoothMesh ? "Disable smooth mode" : "Enable smooth mode"))
 			{
@@ -339,6 +476,32 @@ int Application::Start()
 			{
 				wireframe = !wireframe;
 			}
+			// Drawing without vertex and index buffers, which frees their memory
+			if (ImGui::Checkbox("Vertex pulling", &vertexPulling))
+			{
+				generateGridMesh(&meshGeneratorShader, &calculatorComputeShader);
+			}
+			// Layout of the index buffer, vertex pulling always uses strips
+			if (!vertexPulling)
+			{
+				int topology = (int)meshTopology;
+				ImGui::Text("Mesh topology");
+				ImGui::RadioButton("Triangle list", &topology, (int)MeshTopology::TriangleList); ImGui::SameLine();
+				ImGui::RadioButton("Triangle strips", &topology, (int)MeshTopology::TriangleStrip);
+				if (topology != (int)meshTopology)
+				{
+					meshTopology = (MeshTopology)topology;
+					generateGridMesh(&meshGeneratorShader, &calculatorComputeShader);
+				}
+				if (ImGui::Button("Benchmark mesh topologies"))
+				{
+					topologyReport = benchmarkTopologies(&calculatorShader, &meshGeneratorShader, &calculatorComputeShader);
+				}
+				if (!topologyReport.empty())
+				{
+					ImGui::Text("%s", topologyReport.c_str());
+				}
+			}
 
 			// Detail level
 			ImGui::Text("Quality");
@@ -357,14 +520,44 @@ int Application::Start()
 				generateGridMesh(&meshGeneratorShader, &calculatorComputeShader);
 			}
 
+			// Switching between calculating on the GPU and the CPU
+			if (ImGui::Checkbox("Calculate on the CPU", &cpuCalculation))
+			{
+				updatedData = calculate(activeComputeShader, true);
+			}
+			// Compiling the function to native code for the CPU calculation
+			if (cpuCalculation && JitFunction::isSupported() && ImGui::Checkbox("Compile to native code", &jitCalculation))
+			{
+				cpuEvaluator.setJitEnabled(jitCalculation);
+				updatedData = calculate(activeComputeShader, true);
+			}
+
+			// Compiling variables that stopped changing into the shader as constants
+			// The baker turns itself off when a baked version does not link
+			bakeVariables = variableBaker.isEnabled();
+			if (!cpuCalculation && ImGui::Checkbox("Bake unchanged variables into the shader", &bakeVariables))
+			{
+				variableBaker.setEnabled(bakeVariables);
+			}
+			if (!cpuCalculation && !bakeVariables && variableBaker.hasFailed())
+			{
+				ImGui::Text("Baking was turned off: a baked version did not link");
+			}
+			if (!cpuCalculation && bakeVariables)
+			{
+				ImGui::Text("%s (%u baked versions)", variableBaker.isCompiling() ? "Baking..."
+					: activeComputeShader != &calculatorComputeShader ? "Using baked variables" : "Using the variables buffer",
+					variableBaker.getBakeCount());
+			}
+
 			// Show checkbox and optionally button for automatic updating of graph data
 			ImGui::Checkbox("Automatically update graph data on variable change", &autoUpdate);
 			if (!autoUpdate && ImGui::Button("Update graph data"))
 			{
-				// Setting the user variables
-				variableHandler.setVariables(&calculatorComputeShader);
-				// Always force update, as variable changes can only be detected on the frame they occur
-				updatedData = calculate(&calculatorComputeShader, heightsSSBO, true);
+				// Uploading the changed user variables
+				variableHandler.uploadVariables();
+				// Always force update, as the variables may have been uploaded before without calculating
+				updatedData = calculate(activeComputeShader, true);
 			}
 
 			ImGui::Separator();
@@ -398,7 +591,118 @@ int Application::Start()
 				{
 					ImGui::Text("Data not being updated");
 				}
-				ImGui::Text(("FPS: " + std::to_string(1.0f/deltaTime)).c_str());
+				// Percentiles over the last frames show stutter that a single frame's FPS hides
+				frameStats.drawGui();
+				ImGui::Text("Uniform name lookups skipped: %llu", AbstractShader::getLookupsAvoided());
+				ImGui::Text("Program binary cache: %u hits, %u misses, %u evicted", ProgramCache::getInstance().getHitCount(),
+					ProgramCache::getInstance().getMissCount(), ProgramCache::getInstance().getEvictionCount());
+				// Proof that dragging a variable never reallocates: only size changes allocate
+				ImGui::Text("Height buffer allocations: %u, calculations since: %u, GPU waits: %u",
+					heightBuffer.getAllocationCount(), heightBuffer.getWritesSinceAllocation(), heightBuffer.getWaitCount());
+				ImGui::Text("GPU calculations done before drawing: %u of %u", overlappedCalculations, gpuCalculations);
+				ImGui::Text("Variables: %u, uploads: %u (%u bytes)", (unsigned int)variableHandler.getValues().size(),
+					variableHandler.getUploadCount(), (unsigned int)variableHandler.getUploadedBytes());
+
+				// Compute workgroup size and the auto-tuning results
+				if (!workgroupReport.empty())
+				{
+					ImGui::Text("%s", workgroupReport.c_str());
+				}
+
+				// Rolling CPU and GPU times of every pass
+				ImGui::Separator();
+				profiler.drawGui();
+				ImGui::Separator();
+
+				// CPU calculation details
+				if (cpuCalculation)
+				{
+					ImGui::Text("CPU calculation: %.2f ms on %u threads (%s)",
+						cpuCalculationTime, cpuEvaluator.getThreadCount(), SimdMath::getInstructionSet());
+					if (cpuEvaluator.isJitActive())
+					{
+						const JitCompiler& jitCompiler = cpuEvaluator.getJitCompiler();
+						ImGui::Text("Native code (%s) cache: %u hits, %u misses, %u evictions", JitFunction::getInstructionSet(),
+							jitCompiler.getHitCount(), jitCompiler.getMissCount(), jitCompiler.getEvictionCount());
+					}
+				}
+			}
+
+			// Sweeping variables over a number of steps, calculated at once and then scrubbed or played
+			if (ImGui::CollapsingHeader("Parameter sweep"))
+			{
+				if (ImGui::SliderInt("Steps", &sweepSteps, 2, 500))
+				{
+					variableSweep.setStepCount(sweepSteps);
+				}
+
+				const std::vector<std::string>& names = variableHandler.getNames();
+				for (size_t i = 0; i < names.size(); i++)
+				{
+					ImGui::PushID(names[i].c_str());
+					VariableSweep::Track* track = variableSweep.getTrack(names[i]);
+					bool swept = track != nullptr;
+					if (ImGui::Checkbox(("Sweep " + names[i]).c_str(), &swept))
+					{
+						// Starting with a range from the current value
+						if (swept)
+							variableSweep.setRange(names[i], variableHandler.getValues()[i], variableHandler.getValues()[i] + 1.0f);
+						else
+							variableSweep.removeTrack(names[i]);
+						track = variableSweep.getTrack(names[i]);
+					}
+					if (track != nullptr)
+					{
+						// Position along the sweep (0 to 1) and value of every keyframe
+						for (size_t k = 0; k < track->keyframes.size(); k++)
+						{
+							ImGui::PushID((int)k);
+							if (ImGui::DragFloat2("Position, value", &track->keyframes[k].position, 0.01f))
+							{
+								track->keyframes[k].position = std::min(std::max(track->keyframes[k].position, 0.0f), 1.0f);
+								variableSweep.invalidate();
+							}
+							ImGui::PopID();
+						}
+						if (ImGui::Button("Add keyframe"))
+						{
+							track->keyframes.push_back({ 0.5f, variableHandler.getValues()[i] });
+							variableSweep.invalidate();
+						}
+						if (track->keyframes.size() > 1)
+						{
+							ImGui::SameLine();
+							if (ImGui::Button("Remove keyframe"))
+							{
+								track->keyframes.pop_back();
+								variableSweep.invalidate();
+							}
+						}
+					}
+					ImGui::PopID();
+				}
+
+				if (ImGui::Button("Calculate sweep"))
+				{
+					variableSweep.calculate(variableHandler.getNames(), variableHandler.getValues(), size, scale, graphWidth, center,
+						workgroupSize, cpuCalculation ? &cpuEvaluator : nullptr);
+					showSweep = true;
+					sweepStep = 0;
+				}
+				if (variableSweep.isCalculated(size, scale, graphWidth, center))
+				{
+					// Scrubbing only binds another layer of the stack
+					ImGui::Checkbox("Show sweep", &showSweep);
+					ImGui::SliderInt("Step", &sweepStep, 0, (int)variableSweep.getCalculatedSteps() - 1);
+					ImGui::Checkbox("Play", &playSweep);
+					ImGui::SliderFloat("Duration (s)", &sweepDuration, 0.5f, 30.0f);
+				}
+				else if (showSweep)
+				{
+					ImGui::Text("The sweep is out of date, calculate it again.");
+				}
+				ImGui::Text("Stack: %u steps, %.1f MB, %u dispatches so far", variableSweep.getCalculatedSteps(),
+					variableSweep.getStackBytes() / (1024.0f * 1024.0f), variableSweep.getDispatchCount());
 			}
 
 			// Camera settings (speed, fov etc.)
@@ -409,6 +713,90 @@ int Application::Start()
 				ImGui::SliderFloat("Field of view", camera.getFovPointer(), 10.0f, 90.0f);
 			}
 
+			// Rendering only when something changed, vertical sync and frame cap
+			if (ImGui::CollapsingHeader("Rendering"))
+			{
+				ImGui::Checkbox("Only render on changes", &renderOnDemand);
+				// The line pass is kept to compare against
+				ImGui::Checkbox("Single-pass edges", &singlePassEdges);
+				if (ImGui::Checkbox("Vertical sync", &vsync))
+				{
+					glfwSwapInterval(vsync ? 1 : 0);
+				}
+				ImGui::SliderInt("Frame cap (0 is off)", &frameCap, 0, 240);
+				ImGui::Text("Frames rendered: %u", renderedFrames);
+			}
+
+			// Chunks of finer detail close to the camera, instead of the same grid size everywhere
+			if (ImGui::CollapsingHeader("Level of detail"))
+			{
+				if (ImGui::Checkbox("Adaptive level of detail", &adaptiveDetail))
+				{
+					lodTerrain.setEnabled(adaptiveDetail);
+					// The grid was not calculated while the chunks were drawn
+					if (!adaptiveDetail)
+						updatedData = calculate(activeComputeShader, true);
+				}
+				if (ImGui::SliderInt("Finest level", &lodLevel, 0, LodTerrain::MAX_LEVEL))
+				{
+					lodTerrain.setMaxLevel(lodLevel);
+				}
+				if (ImGui::SliderFloat("Detail distance", &lodDistance, 0.5f, 8.0f))
+				{
+					lodTerrain.setDetailDistance(lodDistance);
+				}
+				int finestSize = (LodTerrain::CHUNK_SAMPLES - 1) << lodLevel;
+				ImGui::Text("Finest detail: %d x %d cells", finestSize, finestSize);
+				ImGui::Text("%u chunks, %u vertices", lodTerrain.getChunkCount(), lodTerrain.getVertexCount());
+				ImGui::Text("Chunks calculated: %u last frame, %u in total", lodTerrain.getCalculatedChunks(), lodTerrain.getTotalCalculatedChunks());
+			}
+
+			// Keeping calculated heights, so returning to earlier variables only copies them
+			if (ImGui::CollapsingHeader("Height cache"))
+			{
+				if (ImGui::Checkbox("Cache calculated heights", &cacheHeights))
+				{
+					heightCache.setEnabled(cacheHeights);
+				}
+				bool budgetChanged = ImGui::SliderInt("GPU budget (MB)", &gpuCacheBudget, 0, 2048);
+				budgetChanged |= ImGui::SliderInt("CPU budget (MB)", &cpuCacheBudget, 0, 4096);
+				if (budgetChanged)
+				{
+					heightCache.setBudgets((size_t)gpuCacheBudget * 1024 * 1024, (size_t)cpuCacheBudget * 1024 * 1024);
+				}
+				if (ImGui::Button("Clear cache"))
+				{
+					heightCache.clear();
+				}
+
+				unsigned int hits = heightCache.getGpuHitCount() + heightCache.getCpuHitCount();
+				unsigned int lookups = hits + heightCache.getMissCount();
+				ImGui::Text("Hit rate: %.1f%% (%u GPU hits, %u CPU hits, %u misses)", lookups > 0 ? 100.0f * hits / lookups : 0.0f,
+					heightCache.getGpuHitCount(), heightCache.getCpuHitCount(), heightCache.getMissCount());
+				ImGui::Text("%u entries: %.1f MB on the GPU, %.1f MB on the CPU", (unsigned int)heightCache.getEntryCount(),
+					heightCache.getGpuBytes() / (1024.0f * 1024.0f), heightCache.getCpuBytes() / (1024.0f * 1024.0f));
+				ImGui::Text("Spilled to the CPU: %u, evicted: %u", heightCache.getSpillCount(), heightCache.getEvictionCount());
+			}
+
+			// Keeping tiles of function values, so panning and zooming only calculate the new parts of the domain
+			if (ImGui::CollapsingHeader("Tiled domain"))
+			{
+				if (ImGui::Checkbox("Calculate from tiles", &tiledHeights))
+				{
+					tiledDomain.setEnabled(tiledHeights);
+					updatedData = calculate(activeComputeShader, true);
+				}
+				ImGui::Text("Level %d, %u visible tiles, %u tiles kept", tiledDomain.getLevel(), tiledDomain.getVisibleTiles(),
+					(unsigned int)tiledDomain.getTileCount());
+				if (tiledDomain.hasFallenBack())
+					ImGui::Text("The grid needs more tiles than the atlas holds, it was calculated without tiles");
+				else if (tiledDomain.getCoarserLevels() > 0)
+					ImGui::Text("Tiles are %d levels coarser than the grid, to fit in the atlas", tiledDomain.getCoarserLevels());
+				ImGui::Text("Last calculation: %u evaluated, %u from finer tiles, %u reused", tiledDomain.getEvaluatedTiles(),
+					tiledDomain.getDerivedTiles(), tiledDomain.getReusedTiles());
+				ImGui::Text("Total: %u evaluated, %u reused", tiledDomain.getTotalEvaluatedTiles(), tiledDomain.getTotalReusedTiles());
+			}
+
 			// Customisation of the program (colors etc.)
 			if (ImGui::CollapsingHeader("Customisation"))
 			{
@@ -420,15 +808,83 @@ int Application::Start()
 			ImGui::End();
 		}
 		
-		// Rendering
 		ImGui::Render();
+		profiler.endCpu();
+
+		/* RENDERING */
+
+		// Counting the GPU calculations that were already done by the time the graph is drawn
+		if (updatedData && !cpuCalculation)
+		{
+			gpuCalculations++;
+			if (heightBuffer.isReady())
+				overlappedCalculations++;
+		}
+		
+		// Drawing background
+		glClearColor(clearColor.x * clearColor.w, clearColor.y * clearColor.w, clearColor.z * clearColor.w, clearColor.w);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		
+		// Writing the camera and style of this frame for all programs at once
+		updateFrameUniforms(verticalScale, imGuiVec4ToGlmVec3(upperColor), imGuiVec4ToGlmVec3(lowerColor));
+
+		// Drawing axes
+		profiler.beginGpu("Axes");
+		drawAxes(axesVAO, &shader, &camera);
+		profiler.endGpu();
+		
+		// Drawing a step of the sweep in place of the calculated heights
+		sweepShown = showSweep && variableSweep.isCalculated(size, scale, graphWidth, center);
+		if (sweepShown)
+			variableSweep.bindStep(sweepStep);
+		else
+			heightBuffer.bind();
+
+		// Picking the chunks around the camera, calculating the ones that came into view
+		if (lodTerrain.isEnabled())
+		{
+			profiler.beginGpu("Level of detail");
+			lodTerrain.update(camera.getPosition(), variableHandler.getValues(), scale, graphWidth, center, workgroupSize);
+			profiler.endGpu();
+		}
+
+		// Drawing the graph
+		drawGraph(lodTerrain.isEnabled() ? &lodShader : vertexPulling ? &pullingShader : &calculatorShader, smoothMesh, wireframe);
+
+
+		/* FINALIZING */
+
+		// Drawing the GUI on top
 		//int display_w, display_h;
 		//glfwGetFramebufferSize(window, &display_w, &display_h);
 		//glViewport(0, 0, display_w, display_h);
+		profiler.beginGpu("ImGui");
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		profiler.endGpu();
 		
+		// The GPU is done with this frame's uniforms and heights once everything above is drawn
+		frameUniforms.endFrame();
+		heightBuffer.endFrame();
+		profiler.endFrame();
+		frameStats.endFrame(calculationCount - frameCalculations);
+
 		// Showing the current color buffer to the screen
 		glfwSwapBuffers(window);
+		renderedFrames++;
+
+		// Anything that changes the picture keeps rendering: input, new data, a moving camera or a GUI item in use
+		bool changed = updatedData || pendingComputeShader || variableBaker.isCompiling() || (sweepShown && playSweep) || Callbacks::getEventCount() != frameEvents || ImGui::IsAnyItemActive()
+			|| camera.getPosition() != framePosition || camera.getPitch() != framePitch || camera.getYaw() != frameYaw;
+		unchangedFrames = changed ? 0 : unchangedFrames + 1;
+
+		// Sleeping off the rest of the frame when a frame cap is set
+		if (frameCap > 0)
+		{
+			double frameEnd = currentFrame + 1.0 / frameCap;
+			double remaining = frameEnd - glfwGetTime();
+			if (remaining > 0.0)
+				std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+		}
 	}
 
 
@@ -438,18 +894,264 @@ int Application::Start()
 	ImGui::DestroyContext();
 
 	// Deleting all assigned buffers
-	glDeleteBuffers(1, &VAO);
+	frameUniforms.destroy();
+	profiler.destroy();
+	frameStats.destroy();
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteVertexArrays(1, &pullingVAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
-	glDeleteBuffers(1, &heightsSSBO);
-	glDeleteBuffers(1, &verticesSSBO);
-	glDeleteBuffers(1, &indicesSSBO);
+	heightBuffer.destroy();
+	heightCache.clear();
+	tiledDomain.destroy();
+	lodTerrain.destroy();
+	variableHandler.destroy();
+	variableSweep.destroy();
 
 	// Terminating GLFW
 	glfwTerminate();
 	return 0;
 }
 
+int Application::RunHeadless(const HeadlessSettings& settings)
+{
+	size = details[settings.quality];
+	scale = settings.scale;
+	graphWidth = settings.graphWidth;
+	center = glm::vec2(settings.center[0], settings.center[1]);
+
+	try
+	{
+		cpuEvaluator.setFunction(settings.function);
+	}
+	catch (const ExpressionError& e)
+	{
+		std::cout << "Error: invalid function.\n" << e.what() << std::endl;
+		return 1;
+	}
+
+	variableHandler.setFunction(settings.function);
+	heightCache.setFunction(settings.function);
+	tiledDomain.setFunction(settings.function);
+	tiledDomain.setEnabled(settings.tiled);
+	lodTerrain.setFunction(settings.function);
+	// The grid is not calculated while the chunks are drawn, unless its heights are written first
+	lodTerrain.setEnabled(settings.lodLevel >= 0 && !settings.writeHeights);
+	lodTerrain.setMaxLevel(settings.lodLevel);
+	// Recalculating every frame is meant to measure the calculation
+	heightCache.setEnabled(!settings.recalculate);
+	for (const std::pair<std::string, float>& variable : settings.variables)
+	{
+		if (!variableHandler.setValue(variable.first, variable.second))
+			std::cout << "Warning: the function has no variable " << variable.first << std::endl;
+	}
+
+	GLFWwindow* window = NULL;
+	if (!settings.noGL)
+	{
+		// An invisible window only provides the OpenGL context, everything is drawn into a framebuffer
+		initialiseGLFW();
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = createGLFWWindow(settings.width, settings.height, "Graph");
+		if (window != NULL)
+		{
+			glfwMakeContextCurrent(window);
+			if (!initialiseGLAD())
+			{
+				glfwDestroyWindow(window);
+				window = NULL;
+			}
+		}
+	}
+
+	// Without OpenGL only the heights can be calculated, on the CPU
+	if (window == NULL)
+	{
+		// Only --no-gl has checked that nothing else was asked for
+		if (!settings.noGL)
+		{
+			glfwTerminate();
+			std::cout << "Error: no OpenGL context available. Use --no-gl to only write the heights, calculated on the CPU." << std::endl;
+			return -1;
+		}
+
+		cpuHeights.resize(size * size);
+		cpuEvaluator.calculate(cpuHeights.data(), size, scale, graphWidth, variableHandler.getValues().data(), center.x, center.y);
+		return writePFM(settings.output + ".pfm", size, size, cpuHeights.data()) ? 0 : 1;
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	frameUniforms.create();
+	if (GLAD_GL_VERSION_3_3)
+		frameStats.create();
+
+	int result = 0;
+	try
+	{
+		// Importing and compiling the shaders
+		Shader shader("src/shaders/vertexShader.shader", "src/shaders/fragmentShader.shader");
+		Shader calculatorShader(function, "src/shaders/calculatorVertexShader.shader", "src/shaders/calculatorFragmentShader.shader", true);
+		Shader pullingShader("src/shaders/calculatorPullingVertexShader.shader", "src/shaders/calculatorFragmentShader.shader");
+		Shader lodShader("src/shaders/lodVertexShader.shader", "src/shaders/calculatorFragmentShader.shader");
+		vertexPulling = settings.vertexPulling;
+		singlePassEdges = !settings.lineEdges;
+		meshTopology = settings.strips ? MeshTopology::TriangleStrip : MeshTopology::TriangleList;
+		ComputeShader meshGeneratorShader("src/shaders/meshGenerator.shader");
+		ComputeShader calculatorComputeShader(function, "src/shaders/calculatorComputeShader.shader", true);
+
+		// Creating the mesh and calculating the heights once, as they do not change between frames
+		variableHandler.uploadVariables();
+		generateGridMesh(&meshGeneratorShader, &calculatorComputeShader);
+		unsigned int axesVAO = generateAxesVAO();
+		calculate(&calculatorComputeShader, true);
+
+		// Sweeping variables over the frames: every frame is calculated at once, and each frame draws its own step
+		bool sweep = !settings.sweeps.empty();
+		if (sweep)
+		{
+			const std::vector<std::string>& names = variableHandler.getNames();
+			for (const HeadlessSettings::Sweep& range : settings.sweeps)
+			{
+				if (std::find(names.begin(), names.end(), range.name) != names.end())
+					variableSweep.setRange(range.name, range.from, range.to);
+				else
+					std::cout << "Warning: the function has no variable " << range.name << std::endl;
+			}
+			variableSweep.setFunction(function);
+			variableSweep.setStepCount(settings.frames);
+			variableSweep.calculate(names, variableHandler.getValues(), size, scale, graphWidth, center,
+				workgroupSize, cpuCalculation ? &cpuEvaluator : nullptr);
+		}
+
+		if (settings.writeHeights)
+		{
+			std::vector<float> heights(size * size);
+			glGetNamedBufferSubData(heightBuffer.current(), 0, size * size * sizeof(float), heights.data());
+			if (!writePFM(settings.output + ".pfm", size, size, heights.data()))
+				result = 1;
+		}
+
+		lodTerrain.setEnabled(settings.lodLevel >= 0);
+
+		// Offscreen framebuffer with a colour and depth attachment
+		unsigned int FBO = 0, colorRBO = 0, depthRBO = 0;
+		glGenFramebuffers(1, &FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glGenRenderbuffers(1, &colorRBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+		glGenRenderbuffers(1, &depthRBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WIDTH, HEIGHT);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Error: the offscreen framebuffer is incomplete." << std::endl;
+			result = -1;
+		}
+		glViewport(0, 0, WIDTH, HEIGHT);
+
+		std::vector<unsigned char> pixels(WIDTH * HEIGHT * 3);
+		std::vector<unsigned char> flipped(WIDTH * HEIGHT * 3);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+		// Frames are also rendered without images when only the statistics are wanted
+		bool renderFrames = settings.writeImages || !settings.statsOutput.empty();
+		for (int frame = 0; frame < settings.frames && renderFrames && result != -1; frame++)
+		{
+			frameStats.beginFrame();
+			unsigned int frameCalculations = calculationCount;
+			if (settings.recalculate)
+				calculate(&calculatorComputeShader, true);
+
+			// Orbiting the camera around the y-axis, turning it by the same angle to keep the same view of the graph
+			float angle = glm::radians(settings.orbit * frame);
+			glm::vec3 position(settings.cameraPosition[0], settings.cameraPosition[1], settings.cameraPosition[2]);
+			camera.setPosition(glm::vec3(
+				position.x * cos(angle) - position.z * sin(angle),
+				position.y,
+				position.x * sin(angle) + position.z * cos(angle)));
+			camera.setRotation(settings.pitch, settings.yaw + settings.orbit * frame);
+
+			// Drawing background
+			glClearColor(0.09f, 0.05f, 0.11f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			updateFrameUniforms(settings.verticalScale, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+			if (sweep)
+				variableSweep.bindStep(frame);
+			drawAxes(axesVAO, &shader, &camera);
+			if (lodTerrain.isEnabled())
+				lodTerrain.update(camera.getPosition(), variableHandler.getValues(), scale, graphWidth, center, workgroupSize);
+			drawGraph(lodTerrain.isEnabled() ? &lodShader : vertexPulling ? &pullingShader : &calculatorShader, settings.smoothMesh, settings.wireframe);
+			frameUniforms.endFrame();
+			heightBuffer.endFrame();
+
+			frameStats.endFrame(calculationCount - frameCalculations);
+			if (!settings.writeImages)
+				continue;
+
+			// Reading the frame back, OpenGL starts at the bottom row
+			glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+			for (int y = 0; y < HEIGHT; y++)
+			{
+				std::copy(pixels.begin() + (HEIGHT - 1 - y) * WIDTH * 3, pixels.begin() + (HEIGHT - y) * WIDTH * 3,
+					flipped.begin() + y * WIDTH * 3);
+			}
+
+			std::string frameNumber = std::to_string(frame);
+			frameNumber = std::string(frameNumber.size() < 4 ? 4 - frameNumber.size() : 0, '0') + frameNumber;
+			if (!writePPM(settings.output + "_" + frameNumber + ".ppm", WIDTH, HEIGHT, flipped.data()))
+			{
+				result = 1;
+				break;
+			}
+		}
+
+		if (!settings.statsOutput.empty())
+		{
+			frameStats.finish();
+			std::cout << frameStats.getReport() << std::endl;
+			if (!frameStats.writeCSV(settings.statsOutput))
+				result = 1;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &FBO);
+		glDeleteRenderbuffers(1, &colorRBO);
+		glDeleteRenderbuffers(1, &depthRBO);
+		glDeleteVertexArrays(1, &axesVAO);
+	}
+	catch (const ExpressionError& e)
+	{
+		std::cout << "Error: invalid function.\n" << e.what() << std::endl;
+		result = 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Error: " << e.what() << std::endl;
+		result = -1;
+	}
+
+	// Deleting all assigned buffers
+	frameUniforms.destroy();
+	frameStats.destroy();
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteVertexArrays(1, &pullingVAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	heightBuffer.destroy();
+	heightCache.clear();
+	tiledDomain.destroy();
+	lodTerrain.destroy();
+	variableHandler.destroy();
+	variableSweep.destroy();
+
+	glfwTerminate();
+	return result;
+}
+
 // Initialises and configures GLFW
 void Application::initialiseGLFW()
 {
@@ -494,44 +1196,47 @@ void Application::generateGridIndices(std::vector<unsigned int>* indices, int x,
 		indices->at(i * 6 + 5) = cx + cy * x + x; // 2
 	}
 }
-void Application::generateGridGPU(ComputeShader* computeShader, std::vector<float>* vertices, std::vector<unsigned int>* indices, int size)
+void Application::generateGridStripIndices(std::vector<unsigned int>* indices, int size)
 {
-	// Generating the grid vertices and indices on the GPU
+	for (int cy = 0; cy < size - 1; cy++)
+	{
+		// One strip per row, alternating between the next and the current row of vertices
+		int rowStart = cy * (2 * size + 1);
+		for (int cx = 0; cx < size; cx++)
+		{
+			indices->at(rowStart + cx * 2) = cx + (cy + 1) * size;
+			indices->at(rowStart + cx * 2 + 1) = cx + cy * size;
+		}
+		// Restart index, ending the strip
+		indices->at(rowStart + 2 * size) = 0xFFFFFFFF;
+	}
+}
+void Application::generateGridGPU(ComputeShader* computeShader, int size)
+{
+	// Generating the grid vertices and indices on the GPU, straight into the VBO and EBO
 
 	// Assigning the compute shader
 	computeShader->use();
 
-	computeShader->setInt("size", size);
-	computeShader->setFloat("offset", 2.0f / (float)(size - 1.0f));
+	computeShader->setInt(Uniform::Size, size);
+	computeShader->setFloat(Uniform::Offset, 2.0f / (float)(size - 1.0f));
+	computeShader->setBool(Uniform::Strips, meshTopology == MeshTopology::TriangleStrip);
 
-	// Creating a buffer for the vertices to go into, but not if it already exists
-	if (verticesSSBO == 0)
-		glGenBuffers(1, &verticesSSBO);
-	// Writing all zeroes into the vertex buffer
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, verticesSSBO);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, size * size * 3 * sizeof(float), 0, GL_DYNAMIC_COPY);
-
-	// Creating a buffer for the indices to go into, but not if it already exists
-	if (indicesSSBO == 0)
-		glGenBuffers(1, &indicesSSBO);
-	// Writing all zeroes into the index buffer
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, indicesSSBO);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, (size - 1) * (size - 1) * 6 * sizeof(unsigned int), 0, GL_DYNAMIC_COPY);
+	// Allocating the vertex and index buffers, filled by the GPU and only read by the GPU
+	glNamedBufferData(VBO, size * size * 3 * sizeof(float), 0, GL_STATIC_COPY);
+	glNamedBufferData(EBO, getIndexCount() * sizeof(unsigned int), 0, GL_STATIC_COPY);
 
 	// Bind to slot 0 (vertices) and 1 (indices)
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, verticesSSBO);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, indicesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, VBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, EBO);
 
 	// Running the compute shader
-	glDispatchCompute(size, size, 1);
-	//glDispatchCompute(std::ceil(float(size / 8.0f)), std::ceil(float(size / 8.0f)), 1);
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
-
-	// Reading the data back from the compute shader
-	glGetNamedBufferSubData(verticesSSBO, 0, size * size * 3 * sizeof(float), vertices->data());
-	glGetNamedBufferSubData(indicesSSBO, 0, (size - 1) * (size - 1) * 6 * sizeof(unsigned int), indices->data());
+	computeShader->dispatch(size, size);
+	// The buffers are only used for drawing after this
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
 
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
 }
 
 // Initialises GLAD
@@ -611,82 +1316,285 @@ void Application::drawAxes(unsigned int VAO, Shader* shader, Camera* camera)
 
 	shader->use();
 
-	// Model matrix
+	// Model matrix (view and projection come from the frame uniform buffer)
 	glm::mat4 model = glm::mat4(1.0f);
-	shader->setMat4("model", model);
-
-	// View matrix
-	glm::mat4 view = glm::mat4(1.0f);
-	view = camera->getViewMatrix();
-	shader->setMat4("view", view);
-
-	// Projection matrix
-	glm::mat4 projection;
-	projection = camera->getProjectionMatrix(WIDTH, HEIGHT);
-	shader->setMat4("projection", projection);
+	shader->setMat4(Uniform::Model, model);
 
 	// Binding the VAO
 	glBindVertexArray(VAO);
 
 	// Drawing the x-axis (red)
-	shader->setVector3("color", 194 / 255.0f, 31 / 255.0f, 19 / 255.0f);
+	shader->setVector3(Uniform::Color, 194 / 255.0f, 31 / 255.0f, 19 / 255.0f);
 	glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT /* index type */, 0);
 
 	// Drawing the y-axis (up) (green)
 	model = glm::mat4(1.0f);
 	model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	shader->setMat4("model", model);
-	shader->setVector3("color", 29 / 255.0f, 194 / 255.0f, 57 / 255.0f);
+	shader->setMat4(Uniform::Model, model);
+	shader->setVector3(Uniform::Color, 29 / 255.0f, 194 / 255.0f, 57 / 255.0f);
 	glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT /* index type */, 0);
 
 	// Drawing the z-axis (blue)
 	model = glm::mat4(1.0f);
 	model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	shader->setMat4("model", model);
-	shader->setVector3("color", 19 / 255.0f, 37 / 255.0f, 194 / 255.0f);
+	shader->setMat4(Uniform::Model, model);
+	shader->setVector3(Uniform::Color, 19 / 255.0f, 37 / 255.0f, 194 / 255.0f);
 	glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT /* index type */, 0);
 	glBindVertexArray(0);
 }
 
-bool Application::calculate(ComputeShader* computeShader, unsigned int ssbo, bool forceRun)
+void Application::updateFrameUniforms(float verticalScale, glm::vec3 upperColor, glm::vec3 lowerColor)
+{
+	FrameData data;
+	data.view = camera.getViewMatrix();
+	data.projection = camera.getProjectionMatrix(WIDTH, HEIGHT);
+	data.upperColor = glm::vec4(upperColor, 1.0f);
+	data.lowerColor = glm::vec4(lowerColor, 1.0f);
+	data.graphWidth = generatedGraphWidth;
+	data.verticalScale = verticalScale;
+	frameUniforms.update(data);
+}
+
+void Application::drawGraph(Shader* calculatorShader, bool smoothMesh, bool wireframe)
+{
+	// Binding the shader program
+	calculatorShader->use();
+
+	// Setting uniforms, the camera and style come from the frame uniform buffer
+	calculatorShader->setFloat(Uniform::Offset, 2.0f / (float)(size - 1.0f));
+	calculatorShader->setInt(Uniform::Size, size);
+
+	// Model matrix
+	glm::mat4 model = glm::mat4(1.0f);
+	calculatorShader->setMat4(Uniform::Model, model);
+
+
+	// Binding vertex array
+	glBindVertexArray(vertexPulling ? pullingVAO : VAO);
+
+	// Shading the edges in the same pass as the surface, using the grid coordinates in the fragment shader
+	if (singlePassEdges)
+	{
+		profiler.beginGpu("Surface and edges");
+		calculatorShader->setBool(Uniform::EdgeMode, false);
+		calculatorShader->setBool(Uniform::Edges, !smoothMesh || wireframe);
+		calculatorShader->setBool(Uniform::Surface, !wireframe);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		drawGraphMesh();
+		profiler.endGpu();
+
+		glBindVertexArray(0);
+		return;
+	}
+	calculatorShader->setBool(Uniform::Edges, false);
+	calculatorShader->setBool(Uniform::Surface, true);
+
+	// Binding the VAO if not in wireframe mode
+	if (!wireframe)
+	{
+		// Drawing with colour
+		profiler.beginGpu("Surface");
+		calculatorShader->setBool(Uniform::EdgeMode, false);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		drawGraphMesh();
+		profiler.endGpu();
+	}
+
+	// Drawing edges if not in 'smooth' mode
+	if (!smoothMesh || wireframe)
+	{
+		profiler.beginGpu("Wireframe");
+		calculatorShader->setBool(Uniform::EdgeMode, true);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		glLineWidth(1.0f);
+		drawGraphMesh();
+		profiler.endGpu();
+	}
+
+	// Unbinding vertex array
+	glBindVertexArray(0);
+}
+
+void Application::drawGraphMesh()
+{
+	if (lodTerrain.isEnabled())
+	{
+		// Every chunk is an instance of the same grid
+		lodTerrain.draw();
+	}
+	else if (vertexPulling)
+	{
+		// One triangle strip per row of quads
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * size, size - 1);
+	}
+	else if (meshTopology == MeshTopology::TriangleStrip)
+	{
+		// The largest index separates the rows
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(0xFFFFFFFF);
+		glDrawElements(GL_TRIANGLE_STRIP, getIndexCount(), GL_UNSIGNED_INT /* index type */, 0);
+		glDisable(GL_PRIMITIVE_RESTART);
+	}
+	else
+	{
+		glDrawElements(GL_TRIANGLES, getIndexCount(), GL_UNSIGNED_INT /* index type */, 0);
+	}
+}
+
+unsigned int Application::getIndexCount() const
+{
+	if (meshTopology == MeshTopology::TriangleStrip)
+		return (size - 1) * (2 * size + 1);
+	return (size - 1) * (size - 1) * 6;
+}
+
+std::string Application::benchmarkTopologies(Shader* calculatorShader, ComputeShader* generatorComputeShader, ComputeShader* calculatorComputeShader)
+{
+	const int draws = 10;
+	const MeshTopology topologies[2] = { MeshTopology::TriangleList, MeshTopology::TriangleStrip };
+	const char* topologyNames[2] = { "list", "strip" };
+
+	unsigned int previousSize = size;
+	MeshTopology previousTopology = meshTopology;
+	bool previousVertexPulling = vertexPulling;
+	bool previousLod = lodTerrain.isEnabled();
+	vertexPulling = false;
+	lodTerrain.setEnabled(false);
+
+	std::stringstream report;
+	report << std::fixed << std::setprecision(3) << "Mesh topology benchmark (" << draws << " filled draws):";
+
+	unsigned int query = 0;
+	glGenQueries(1, &query);
+	for (int detail : details)
+	{
+		size = detail;
+		for (int t = 0; t < 2; t++)
+		{
+			meshTopology = topologies[t];
+			generateGridMesh(generatorComputeShader, calculatorComputeShader);
+
+			// The first draw includes driver work that only happens once
+			drawGraph(calculatorShader, true, false);
+			glFinish();
+
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			for (int i = 0; i < draws; i++)
+			{
+				drawGraph(calculatorShader, true, false);
+			}
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			report << "\n  " << size << "x" << size << " " << topologyNames[t] << ": "
+				<< (double)nanoseconds / 1000000.0 / draws << " ms/draw, "
+				<< (double)getIndexCount() * sizeof(unsigned int) / (1024.0 * 1024.0) << " MB of indices";
+		}
+	}
+	glDeleteQueries(1, &query);
+
+	// Restoring the mesh
+	size = previousSize;
+	meshTopology = previousTopology;
+	vertexPulling = previousVertexPulling;
+	lodTerrain.setEnabled(previousLod);
+	generateGridMesh(generatorComputeShader, calculatorComputeShader);
+
+	std::cout << report.str() << std::endl;
+	return report.str();
+}
+
+bool Application::calculate(ComputeShader* computeShader, bool forceRun)
 {
-	// Calculating the heights of each point on the GPU using a compute shader
+	// Calculating the heights of each point on the GPU using a compute shader, or on the CPU if enabled
+
+	// The chunks of the level of detail are drawn instead of the grid, they calculate their own heights.
+	// The grid is calculated again when the level of detail is turned off.
+	if (lodTerrain.isEnabled())
+	{
+		return false;
+	}
 
 	// Setting the changed variables
 	if ((graphWidth == generatedGraphWidth &&
-		scale == generatedScale) && !forceRun)
+		scale == generatedScale && center == generatedCenter) && !forceRun)
 	{
 		// No important changed variables: do not run
 		return false;
 	}
 
-	std::cout << "calculating" << std::endl;
-
 	// Updating the old variables
 	generatedGraphWidth = graphWidth;
 	generatedScale = scale;
+	generatedCenter = center;
+
+	// Does nothing unless the size changed
+	heightBuffer.resize(size * size);
+
+	// Heights of the same function, variables and bounds are copied from the cache
+	// The GPU, the CPU interpreter and the native code are cached apart, so switching between them runs the new one
+	unsigned int backend = !cpuCalculation ? 0 : cpuEvaluator.isJitActive() ? 2 : 1;
+	std::string cacheKey = heightCache.getKey(variableHandler.getValues(), scale, graphWidth, center.x, center.y, size, backend);
+	if (heightCache.load(cacheKey, heightBuffer))
+	{
+		return true;
+	}
+
+	// Resampling from tiles only calculates the parts of the domain that were not calculated before.
+	// The resampled heights are interpolated, so they are not stored with the exact ones in the height cache.
+	if (tiledDomain.isEnabled() && !cpuCalculation)
+	{
+		profiler.beginGpu("Compute tiles");
+		bool tiled = tiledDomain.calculate(variableHandler.getValues(), size, scale, graphWidth, center, workgroupSize, heightBuffer);
+		profiler.endGpu();
+		if (tiled)
+		{
+			if (tiledDomain.getEvaluatedTiles() > 0)
+				calculationCount++;
+			heightBuffer.submit();
+			return true;
+		}
+	}
+
+	std::cout << "calculating" << std::endl;
+	calculationCount++;
+
+	if (cpuCalculation)
+	{
+		// Calculating the heights on the CPU into the height buffer
+		profiler.beginCpu("Calculate heights");
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		heightBuffer.next();
+		// Writing straight into the mapped buffer, which is coherent so no upload is needed
+		cpuEvaluator.calculate(heightBuffer.getMappedMemory(), size, scale, graphWidth, variableHandler.getValues().data(), center.x, center.y);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		cpuCalculationTime = std::chrono::duration<float, std::milli>(end - begin).count();
+		profiler.endCpu();
+		heightCache.store(cacheKey, heightBuffer, size * size);
+		return true;
+	}
 
 	// Assigning the compute shader
 	computeShader->use();
 
-	computeShader->setFloat("scale", scale);
-	computeShader->setFloat("graphWidth", graphWidth);
-	computeShader->setInt("size", size);
-	computeShader->setFloat("offset", 2.0f / (float)(size - 1));
+	computeShader->setFloat(Uniform::Scale, scale);
+	computeShader->setFloat(Uniform::GraphWidth, graphWidth);
+	computeShader->setInt(Uniform::Size, size);
+	computeShader->setFloat(Uniform::Offset, 2.0f / (float)(size - 1));
+	computeShader->setVector2(Uniform::Center, center);
 
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, size * size * sizeof(float), 0, GL_DYNAMIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo);
-
-	// Bind to slot 2 (heights)
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo);
+	// Writing into the next buffer of the ring (bound to slot 2), while earlier draws may still read the previous one
+	heightBuffer.next();
 
 	// Running the compute shader
-	glDispatchCompute(size, size, 1);
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
-
-	// Unbinding the buffer
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	profiler.beginGpu("Compute heights");
+	computeShader->dispatch(size, size);
+	profiler.endGpu();
+	// The heights are only read as a storage buffer by the graph's vertex shader
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	heightCache.store(cacheKey, heightBuffer, size * size);
+	heightBuffer.submit();
 
 	// Updated graph data: return true
 	return true;
@@ -695,55 +1603,74 @@ bool Application::calculate(ComputeShader* computeShader, unsigned int ssbo, boo
 void Application::generateGridMesh(ComputeShader* generatorComputeShader, 
 	ComputeShader* calculatorComputeShader)
 {
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-	
-	// CPU generated vertices
-	std::vector<float> vertices(size * size * 3);
-	std::vector<unsigned int> indices((size - 1) * (size - 1) * 6);
-	
-	std::chrono::steady_clock::time_point gpu_begin = std::chrono::steady_clock::now();
-	// With a size of 5000, the GPU generator is almost 10 times as fast!
-	// size=3200 -> t=~280ms
-	generateGridGPU(generatorComputeShader, &vertices, &indices, size);
-	//generateGridGPU(generatorComputeShader, &vertices, &indices, size);
-	std::chrono::steady_clock::time_point gpu_end = std::chrono::steady_clock::now();
-	
-	std::cout << "GPU mesh gen. time = " << std::chrono::duration_cast<std::chrono::microseconds>(gpu_end - gpu_begin).count() << " microseconds" << std::endl;
-
-	// Don't regenerate VBO
+	// Don't regenerate the VAO, VBO and EBO
+	if (VAO == 0)
+	{
+		glGenVertexArrays(1, &VAO);
+	}
 	if (VBO == 0)
 	{
 		// Making a buffer with the ID in VBO
 		glGenBuffers(1, &VBO);
 	}
-	// Binding our new buffer to the GL_ARRAY_BUFFER target
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	// Binding our custom data into the buffer
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-
-	// Don't regenerate EBO
 	if (EBO == 0)
 	{
 		// Generating a buffer for the EBO
 		glGenBuffers(1, &EBO);
 	}
-	// Binding the EBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	// Inserting data into the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	if (vertexPulling)
+	{
+		// The vertex shader derives the positions itself: releasing the mesh memory
+		if (pullingVAO == 0)
+		{
+			// Drawing still requires a vertex array, it just has no attributes
+			glGenVertexArrays(1, &pullingVAO);
+		}
+		glNamedBufferData(VBO, 0, NULL, GL_STATIC_DRAW);
+		glNamedBufferData(EBO, 0, NULL, GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBindVertexArray(VAO);
+
+		std::chrono::steady_clock::time_point gpu_begin = std::chrono::steady_clock::now();
+		if (GLAD_GL_VERSION_4_3)
+		{
+			// With a size of 5000, the GPU generator is almost 10 times as fast!
+			// The data never leaves the GPU
+			generateGridGPU(generatorComputeShader, size);
+		}
+		else
+		{
+			// CPU generated vertices, when compute shaders are not supported
+			std::vector<float> vertices(size * size * 3);
+			std::vector<unsigned int> indices(getIndexCount());
+			generateGrid(&vertices, size);
+			if (meshTopology == MeshTopology::TriangleStrip)
+				generateGridStripIndices(&indices, size);
+			else
+				generateGridIndices(&indices, size, size);
+
+			glNamedBufferData(VBO, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+			glNamedBufferData(EBO, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		}
+		std::chrono::steady_clock::time_point gpu_end = std::chrono::steady_clock::now();
 	
-	// Telling OpenGL how to interpret the data (only position data for now)
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+		std::cout << "Mesh gen. time = " << std::chrono::duration_cast<std::chrono::microseconds>(gpu_end - gpu_begin).count() << " microseconds" << std::endl;
 
-	// Creating a buffer for the heights to go into
-	if (heightsSSBO == 0)
-	{
-		glGenBuffers(1, &heightsSSBO);
+		// Binding the buffers to the VAO
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	
+		// Telling OpenGL how to interpret the data (only position data for now)
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
 	}
+
+	// Allocating the height buffers, which only happens when the size changed
+	heightBuffer.resize(size * size);
 	// We have to recalculate heights on change of size, as the height data is totally redundant at that point
-	calculate(calculatorComputeShader, heightsSSBO, true);
+	calculate(calculatorComputeShader, true);
 
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
@@ -18,6 +18,16 @@
 #include "Camera.h"
 #include "Callbacks.h"
 #include "VariableHandler.h"
+#include "CpuEvaluator.h"
+#include "HeadlessSettings.h"
+#include "FrameUniforms.h"
+#include "HeightBuffer.h"
+#include "HeightCache.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "VariableSweep.h"
+#include "TiledDomain.h"
+#include "LodTerrain.h"
 
 // ImGui
 #include "imgui/imgui.h"
@@ -39,6 +49,15 @@
 #endif
 
 
+// How the indexed graph mesh is put together
+enum class MeshTopology
+{
+	// 6 indices per quad
+	TriangleList,
+	// A strip of 2 * size indices per row of quads, separated by a restart index
+	TriangleStrip
+};
+
 class Application
 {
 public:
@@ -48,6 +67,9 @@ public:
 	// Starts the program
 	int Start();
 
+	// Renders frames into an offscreen framebuffer and writes them to disk, without a visible window or GUI
+	int RunHeadless(const HeadlessSettings& settings);
+
 private:
 	Camera camera;
 	const int WIDTH;
@@ -61,16 +83,63 @@ private:
 	float generatedGraphWidth = 0.0f; // Holds the old value of graphWidth if it changes
 	float scale = 3.0f;
 	float generatedScale = 0.0f; // Holds the old value of scale if it changes
+	glm::vec2 center = glm::vec2(0.0f); // Point of the function at the middle of the graph
+	glm::vec2 generatedCenter = glm::vec2(0.0f); // Holds the old value of center if it changes
 	unsigned int size = 400;
+	// Grid size of every quality level
+	const int details[4] = { 100, 400, 900, 1600 };
 
 	// Buffers for the mesh data
 	unsigned int VAO = 0;
 	unsigned int VBO = 0;
 	unsigned int EBO = 0;
-	// Mesh data buffers
-	unsigned int heightsSSBO = 0;
-	unsigned int verticesSSBO = 0;
-	unsigned int indicesSSBO = 0;
+	// Height data buffers
+	HeightBuffer heightBuffer;
+	// Heights calculated before, copied instead of calculated again
+	HeightCache heightCache;
+	// Tiles of function values kept across pans and zooms
+	TiledDomain tiledDomain;
+	// Chunks of the graph around the camera, drawn instead of the uniform grid when enabled
+	LodTerrain lodTerrain;
+
+	// Camera and style uniforms shared by all programs
+	FrameUniforms frameUniforms;
+
+	// CPU and GPU times of the passes of every frame
+	Profiler profiler;
+	// Frame time percentiles over the last frames
+	FrameStats frameStats;
+	// Number of height calculations so far, to count them per frame
+	unsigned int calculationCount = 0;
+
+	MeshTopology meshTopology = MeshTopology::TriangleList;
+	// Results of the last topology benchmark
+	std::string topologyReport;
+
+	// Drawing the surface and its edges in one pass, instead of a second pass with polygon mode GL_LINE
+	bool singlePassEdges = true;
+
+	// Drawing the graph without vertex and index buffers, reading the heights directly in the vertex shader
+	bool vertexPulling = false;
+	unsigned int pullingVAO = 0;
+
+	// Workgroup size of the compute shaders, picked by auto-tuning at startup
+	glm::uvec2 workgroupSize = glm::uvec2(8, 8);
+	std::string workgroupReport;
+
+	// Will handle user variables
+	VariableHandler variableHandler;
+	// Sweeps of the user variables, calculated into a stack of heightfields
+	VariableSweep variableSweep;
+
+	// Calculating the heights on the CPU instead of with the compute shader
+	bool cpuCalculation = false;
+	// Running the CPU calculation as native code instead of bytecode
+	bool jitCalculation = false;
+	CpuEvaluator cpuEvaluator;
+	std::vector<float> cpuHeights;
+	// Time the last CPU calculation took in milliseconds
+	float cpuCalculationTime = 0.0f;
 
 	// Initialise and configure GLFW
 	void initialiseGLFW();
@@ -84,10 +153,25 @@ private:
 	// Draw the axes
 	void drawAxes(unsigned int VAO, Shader* shader, Camera* camera);
 
+	// Write the camera and style of the current frame to the frame uniform buffer
+	void updateFrameUniforms(float verticalScale, glm::vec3 upperColor, glm::vec3 lowerColor);
+
+	// Draw the graph mesh with the calculated heights, using the current frame uniforms
+	void drawGraph(Shader* calculatorShader, bool smoothMesh, bool wireframe);
+	// Issue the draw call for the graph with the current mesh mode
+	void drawGraphMesh();
+
+	// Get the number of indices of the mesh with the current size and topology
+	unsigned int getIndexCount() const;
+
+	// Time drawing the graph with every topology on every quality level, returns the results.
+	// Restores the current size and topology afterwards.
+	std::string benchmarkTopologies(Shader* calculatorShader, ComputeShader* generatorComputeShader, ComputeShader* calculatorComputeShader);
+
 
 	// Calculate the actual graph data using the input function
 	// Returns whether the data was updated
-	bool calculate(ComputeShader* computeShader, unsigned int ssbo, bool forceRun);
+	bool calculate(ComputeShader* computeShader, bool forceRun);
 
 
 
@@ -102,7 +186,9 @@ private:
 	// Modify the input array such that it is a grid
 	void generateGrid(std::vector<float>* vertices, int size);
 	void generateGridIndices(std::vector<unsigned int>* indices, int x, int y);
-	void generateGridGPU(ComputeShader* computeShader, std::vector<float>* vertices, std::vector<unsigned int>* indices, int size);
+	void generateGridStripIndices(std::vector<unsigned int>* indices, int size);
+	// Generate the grid directly into the VBO and EBO with the given compute shader, without a round trip through the CPU
+	void generateGridGPU(ComputeShader* computeShader, int size);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "CpuEvaluator.h"
+#include "SimdMath.h"
+
+// Reference calculation of a single point with the standard library
+static float evaluateScalar(const ExpressionNode* node, float x, float z, const float* variables)
+{
+	switch (node->type)
+	{
+	case ExpressionNode::Type::Number:
+	case ExpressionNode::Type::Constant:
+		return (float)node->value;
+	case ExpressionNode::Type::Input:
+		return node->name == "x" ? x : z;
+	case ExpressionNode::Type::Variable:
+		return variables[node->index];
+	default:
+		break;
+	}
+
+	float a = evaluateScalar(node->children[0].get(), x, z, variables);
+	float b = node->children.size() > 1 ? evaluateScalar(node->children[1].get(), x, z, variables) : 0.0f;
+
+	switch (node->type)
+	{
+	case ExpressionNode::Type::Negate: return -a;
+	case ExpressionNode::Type::Add: return a + b;
+	case ExpressionNode::Type::Subtract: return a - b;
+	case ExpressionNode::Type::Multiply: return a * b;
+	case ExpressionNode::Type::Divide: return a / b;
+	default: break;
+	}
+
+	const std::string& name = node->name;
+	if (name == "sin") return std::sin(a);
+	if (name == "cos") return std::cos(a);
+	if (name == "tan") return std::tan(a);
+	if (name == "asin") return std::asin(a);
+	if (name == "acos") return std::acos(a);
+	if (name == "atan") return std::atan(a);
+	if (name == "exp") return std::exp(a);
+	// Like GLSL, a negative base is not supported
+	if (name == "pow") return a < 0.0f && b != 0.0f ? std::nanf("") : std::pow(a, b);
+	if (name == "sqrt") return std::sqrt(a);
+	if (name == "abs") return std::abs(a);
+	if (name == "floor") return std::floor(a);
+	if (name == "ceil") return std::ceil(a);
+	if (name == "min") return std::min(a, b);
+	if (name == "max") return std::max(a, b);
+	return 0.0f;
+}
+
+// Infinities and NaN can not be subtracted, they have to be the same kind of value with the same sign
+static bool sameNonFinite(double expected, double actual)
+{
+	return std::isnan(expected) ? std::isnan(actual)
+		: std::isinf(expected) && std::isinf(actual) && std::signbit(expected) == std::signbit(actual);
+}
+
+// Compare the native code with the bytecode interpreter on functions with domain errors, overflow and signed zeros,
+// which have to give the same infinities and NaN. Returns whether every function matched.
+static bool compareJitWithInterpreter()
+{
+	const char* functions[] = { "pow(x,z)", "pow(x,2)", "pow(x-z,0)", "pow(0,z)", "exp(x*z*10)", "exp(1/x)", "exp(floor(asin(z)))",
+		"floor(asin(z))", "floor(sqrt(-x))", "ceil(x)", "ceil(sqrt(x*z))", "acos(x)+asin(z)", "sqrt(x*z)", "1/x+1/z",
+		"cos(1/x)", "sin(1/(x*z))", "tan(1/z)", "atan(1/x)", "abs(pow(z,x))" };
+	const unsigned int size = 101;
+	const float scale = 3.0f;
+	const float variables[1] = { 0.0f };
+
+	std::cout << "Native code against the interpreter, on functions with domain errors:" << std::endl;
+	CpuEvaluator evaluator;
+	std::vector<float> interpreted(size * size);
+	std::vector<float> compiled(size * size);
+	bool passed = true;
+	for (const char* function : functions)
+	{
+		evaluator.setFunction(function);
+		evaluator.setJitEnabled(false);
+		evaluator.calculate(interpreted.data(), size, scale, 1.0f, variables);
+		evaluator.setJitEnabled(true);
+		evaluator.calculate(compiled.data(), size, scale, 1.0f, variables);
+
+		unsigned int mismatches = 0;
+		for (size_t i = 0; i < interpreted.size(); i++)
+		{
+			double expected = interpreted[i];
+			double actual = compiled[i];
+			bool same = std::isfinite(expected) && std::isfinite(actual)
+				? std::abs(actual - expected) / std::max(1.0, std::abs(expected)) < 1e-4 : sameNonFinite(expected, actual);
+			if (!same)
+				mismatches++;
+		}
+		passed = passed && mismatches == 0;
+		std::cout << function << ": " << mismatches << " mismatches" << std::endl;
+	}
+	std::cout << std::endl;
+	return passed;
+}
+
+int runCpuBenchmark(const std::string& function)
+{
+	const unsigned int details[4] = { 100, 400, 900, 1600 };
+	const int iterations = 20;
+	const float scale = 3.0f;
+	const float graphWidth = 1.0f;
+
+	CpuEvaluator evaluator;
+	try
+	{
+		evaluator.setFunction(function);
+	}
+	catch (const ExpressionError& e)
+	{
+		std::cout << "Error: invalid function.\n" << e.what() << std::endl;
+		return 1;
+	}
+	Expression expression(function);
+
+	// Some values for the variables, whatever they are called
+	const float values[6] = { 0.5f, 0.25f, 1.0f, 2.0f, 3.0f, 4.0f };
+	std::vector<float> variables(std::max<size_t>(expression.getVariables().size(), 1));
+	for (size_t i = 0; i < variables.size(); i++)
+	{
+		variables[i] = values[i % 6];
+	}
+
+	std::cout << "CPU evaluator benchmark for " << function << std::endl;
+	std::cout << evaluator.getThreadCount() << " threads, " << SimdMath::getInstructionSet() << ", "
+		<< evaluator.getProgram().getInstructions().size() << " instructions on batches of " << BytecodeProgram::BATCH_SIZE << " points:\n"
+		<< evaluator.getProgram().disassemble() << std::endl;
+
+	bool passed = true;
+	// Running the bytecode interpreter, then the native code if it is supported
+	for (int jit = 0; jit < (JitFunction::isSupported() ? 2 : 1); jit++)
+	{
+		evaluator.setJitEnabled(jit == 1);
+		if (evaluator.isJitActive())
+			std::cout << "Native code (" << JitFunction::getInstructionSet() << "):" << std::endl;
+		else
+			std::cout << "Bytecode interpreter:" << std::endl;
+
+		for (unsigned int size : details)
+		{
+			std::vector<float> heights(size * size);
+
+			// Warming up the threads and caches
+			evaluator.calculate(heights.data(), size, scale, graphWidth, variables.data());
+
+			std::vector<double> times;
+			for (int i = 0; i < iterations; i++)
+			{
+				std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+				evaluator.calculate(heights.data(), size, scale, graphWidth, variables.data());
+				std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+				times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+			}
+			std::sort(times.begin(), times.end());
+
+			// Comparing against the scalar calculation, relative to the magnitude of the values
+			double maxError = 0.0;
+			unsigned int mismatches = 0;
+			float offset = 2.0f / (float)(size - 1);
+			for (unsigned int cz = 0; cz < size; cz++)
+			{
+				for (unsigned int cx = 0; cx < size; cx++)
+				{
+					float x = ((float)cx * offset - 1.0f) * scale * graphWidth;
+					float z = ((float)cz * offset - 1.0f) * scale * graphWidth;
+					double expected = evaluateScalar(expression.getRoot(), x, z, variables.data()) / scale;
+					double actual = heights[cx + size * cz];
+					if (!std::isfinite(expected) || !std::isfinite(actual))
+					{
+						if (!sameNonFinite(expected, actual))
+							mismatches++;
+						continue;
+					}
+					maxError = std::max(maxError, std::abs(actual - expected) / std::max(1.0, std::abs(expected)));
+				}
+			}
+			bool accurate = maxError < 1e-4 && mismatches == 0;
+			passed = passed && accurate;
+
+			std::cout << size << "x" << size << " (" << size * size << " samples): "
+				<< "min " << times.front() << " ms, median " << times[times.size() / 2] << " ms, "
+				<< (double)size * size / times.front() / 1000.0 << " Msamples/s, "
+				<< "max error " << maxError << ", " << mismatches << " non-finite mismatches" << (accurate ? "" : " (too large)") << std::endl;
+		}
+		std::cout << std::endl;
+	}
+
+	if (JitFunction::isSupported() && !compareJitWithInterpreter())
+		passed = false;
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+// Benchmarks that run without creating a window, started from the command line
+
+// Times the CPU evaluator on every quality level and checks its results against a scalar calculation.
+// Returns the exit code for the program.
+int runCpuBenchmark(const std::string& function);
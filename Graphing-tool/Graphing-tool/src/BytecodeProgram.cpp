@@ -0,0 +1,421 @@
+#include "BytecodeProgram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "SimdMath.h"
+
+// Names of the opcodes for disassembling, in the same order as the enum
+static const char* opcodeNames[] = {
+	"load", "copy", "neg", "add", "sub", "mul", "div",
+	"adds", "subs", "ssub", "muls", "divs", "sdiv",
+	"sin", "cos", "tan", "asin", "acos", "atan", "exp", "pow",
+	"sqrt", "abs", "floor", "ceil", "min", "max"
+};
+
+BytecodeProgram::BytecodeProgram()
+{
+	// An empty program calculates 0
+	constants.push_back(0.0f);
+	emit(Opcode::LoadScalar, 0, 0, firstConstantScalar);
+}
+
+BytecodeProgram::BytecodeProgram(const Expression& expression)
+{
+	registerCount = 0;
+
+	// The variables come right after z, the constants after them
+	variableNames = expression.getVariables();
+	if (FIRST_VARIABLE_SCALAR + variableNames.size() > 255)
+	{
+		throw ExpressionError("Function has too many variables", 0);
+	}
+	firstConstantScalar = (uint8_t)(FIRST_VARIABLE_SCALAR + variableNames.size());
+
+	Operand result = compileNode(expression.getRoot());
+
+	// The result must end up in register 0, which is the output
+	if (registerCount == 0)
+		registerCount = 1;
+	if (result.isScalar)
+		emit(Opcode::LoadScalar, 0, 0, result.index);
+	else if (result.index != 0)
+		emit(Opcode::Copy, 0, result.index, 0);
+}
+
+void BytecodeProgram::prepare(Workspace& workspace, const float* variables) const
+{
+	workspace.registers.resize((registerCount - 1) * BATCH_SIZE);
+
+	// Register 0 is the output and the last register the x coordinates, both set on execution
+	workspace.registerPointers.assign(256, nullptr);
+	for (unsigned int i = 1; i < registerCount; i++)
+	{
+		workspace.registerPointers[i] = &workspace.registers[(i - 1) * BATCH_SIZE];
+	}
+
+	workspace.scalars.resize(getScalarCount());
+	workspace.scalars[Z_SCALAR] = 0.0f;
+	std::copy(variables, variables + variableNames.size(), workspace.scalars.begin() + FIRST_VARIABLE_SCALAR);
+	std::copy(constants.begin(), constants.end(), workspace.scalars.begin() + firstConstantScalar);
+}
+
+void BytecodeProgram::execute(Workspace& workspace, const float* x, float z, float* out, unsigned int count) const
+{
+	float** r = workspace.registerPointers.data();
+	r[0] = out;
+	r[X_REGISTER] = const_cast<float*>(x);
+
+	float* s = workspace.scalars.data();
+	s[Z_SCALAR] = z;
+
+	for (const Instruction& instruction : instructions)
+	{
+		float* d = r[instruction.destination];
+		const float* a = r[instruction.a];
+		const float* b = r[instruction.b];
+
+		switch (instruction.opcode)
+		{
+		case Opcode::LoadScalar: SimdMath::fill(s[instruction.b], d, count); break;
+		case Opcode::Copy: std::copy(a, a + count, d); break;
+		case Opcode::Negate: SimdMath::negate(a, d, count); break;
+		case Opcode::Add: SimdMath::add(a, b, d, count); break;
+		case Opcode::Subtract: SimdMath::subtract(a, b, d, count); break;
+		case Opcode::Multiply: SimdMath::multiply(a, b, d, count); break;
+		case Opcode::Divide: SimdMath::divide(a, b, d, count); break;
+		case Opcode::AddScalar: SimdMath::add(a, s[instruction.b], d, count); break;
+		case Opcode::SubtractScalar: SimdMath::subtract(a, s[instruction.b], d, count); break;
+		case Opcode::ScalarSubtract: SimdMath::subtract(s[instruction.b], a, d, count); break;
+		case Opcode::MultiplyScalar: SimdMath::multiply(a, s[instruction.b], d, count); break;
+		case Opcode::DivideScalar: SimdMath::divide(a, s[instruction.b], d, count); break;
+		case Opcode::ScalarDivide: SimdMath::divide(s[instruction.b], a, d, count); break;
+		case Opcode::Sin: SimdMath::sin(a, d, count); break;
+		case Opcode::Cos: SimdMath::cos(a, d, count); break;
+		case Opcode::Tan: SimdMath::tan(a, d, count); break;
+		case Opcode::Asin: SimdMath::asin(a, d, count); break;
+		case Opcode::Acos: SimdMath::acos(a, d, count); break;
+		case Opcode::Atan: SimdMath::atan(a, d, count); break;
+		case Opcode::Exp: SimdMath::exp(a, d, count); break;
+		case Opcode::Pow: SimdMath::pow(a, b, d, count); break;
+		case Opcode::Sqrt: SimdMath::sqrt(a, d, count); break;
+		case Opcode::Abs: SimdMath::abs(a, d, count); break;
+		case Opcode::Floor: SimdMath::floor(a, d, count); break;
+		case Opcode::Ceil: SimdMath::ceil(a, d, count); break;
+		case Opcode::Min: SimdMath::min(a, b, d, count); break;
+		case Opcode::Max: SimdMath::max(a, b, d, count); break;
+		}
+	}
+}
+
+const std::vector<BytecodeProgram::Instruction>& BytecodeProgram::getInstructions() const
+{
+	return instructions;
+}
+
+unsigned int BytecodeProgram::getRegisterCount() const
+{
+	return registerCount;
+}
+
+const std::vector<float>& BytecodeProgram::getConstants() const
+{
+	return constants;
+}
+
+uint8_t BytecodeProgram::getFirstConstantScalar() const
+{
+	return firstConstantScalar;
+}
+
+unsigned int BytecodeProgram::getScalarCount() const
+{
+	return firstConstantScalar + (unsigned int)constants.size();
+}
+
+std::string BytecodeProgram::disassemble() const
+{
+	std::stringstream stream;
+
+	auto registerName = [](uint8_t index) -> std::string
+	{
+		return index == X_REGISTER ? "x" : "r" + std::to_string(index);
+	};
+	auto scalarName = [this](uint8_t index) -> std::string
+	{
+		if (index == Z_SCALAR)
+			return "z";
+		if (index < firstConstantScalar)
+			return variableNames[index - FIRST_VARIABLE_SCALAR];
+		std::stringstream constant;
+		constant << constants[index - firstConstantScalar];
+		return constant.str();
+	};
+
+	for (const Instruction& instruction : instructions)
+	{
+		stream << registerName(instruction.destination) << " = " << opcodeNames[(int)instruction.opcode];
+		switch (instruction.opcode)
+		{
+		case Opcode::LoadScalar:
+			stream << " " << scalarName(instruction.b);
+			break;
+		case Opcode::AddScalar: case Opcode::SubtractScalar: case Opcode::ScalarSubtract:
+		case Opcode::MultiplyScalar: case Opcode::DivideScalar: case Opcode::ScalarDivide:
+			stream << " " << registerName(instruction.a) << ", " << scalarName(instruction.b);
+			break;
+		case Opcode::Add: case Opcode::Subtract: case Opcode::Multiply: case Opcode::Divide:
+		case Opcode::Pow: case Opcode::Min: case Opcode::Max:
+			stream << " " << registerName(instruction.a) << ", " << registerName(instruction.b);
+			break;
+		default:
+			stream << " " << registerName(instruction.a);
+			break;
+		}
+		stream << "\n";
+	}
+	return stream.str();
+}
+
+BytecodeProgram::Operand BytecodeProgram::compileNode(const ExpressionNode* node)
+{
+	// Folding everything that does not depend on the inputs or variables
+	if (isConstant(node))
+	{
+		return addConstant((float)evaluateConstant(node));
+	}
+
+	switch (node->type)
+	{
+	case ExpressionNode::Type::Input:
+		if (node->name == "x")
+			return Operand{ false, X_REGISTER };
+		return Operand{ true, Z_SCALAR };
+	case ExpressionNode::Type::Variable:
+		return Operand{ true, (uint8_t)(FIRST_VARIABLE_SCALAR + node->index) };
+	case ExpressionNode::Type::Negate:
+	{
+		Operand operand = toRegister(compileNode(node->children[0].get()));
+		uint8_t destination = destinationFor(operand);
+		emit(Opcode::Negate, destination, operand.index, 0);
+		return Operand{ false, destination };
+	}
+	case ExpressionNode::Type::Add:
+		return compileBinary(node, Opcode::Add);
+	case ExpressionNode::Type::Subtract:
+		return compileBinary(node, Opcode::Subtract);
+	case ExpressionNode::Type::Multiply:
+		return compileBinary(node, Opcode::Multiply);
+	case ExpressionNode::Type::Divide:
+		return compileBinary(node, Opcode::Divide);
+	case ExpressionNode::Type::Function:
+	{
+		Opcode opcode = functionOpcode(node->name);
+		if (node->children.size() > 1)
+			return compileBinary(node, opcode);
+
+		Operand operand = toRegister(compileNode(node->children[0].get()));
+		uint8_t destination = destinationFor(operand);
+		emit(opcode, destination, operand.index, 0);
+		return Operand{ false, destination };
+	}
+	default:
+		// Numbers and constants have been folded already
+		return addConstant(0.0f);
+	}
+}
+
+BytecodeProgram::Operand BytecodeProgram::compileBinary(const ExpressionNode* node, Opcode registerOpcode)
+{
+	Operand a = compileNode(node->children[0].get());
+	Operand b = compileNode(node->children[1].get());
+
+	// Arithmetic with a single value for one operand has its own instructions
+	bool arithmetic = registerOpcode == Opcode::Add || registerOpcode == Opcode::Subtract
+		|| registerOpcode == Opcode::Multiply || registerOpcode == Opcode::Divide;
+
+	if (!arithmetic || (a.isScalar && b.isScalar))
+	{
+		a = toRegister(a);
+		b = toRegister(b);
+	}
+
+	if (a.isScalar || b.isScalar)
+	{
+		Operand source = a.isScalar ? b : a;
+		Operand scalar = a.isScalar ? a : b;
+		Opcode opcode = Opcode::AddScalar;
+		switch (registerOpcode)
+		{
+		case Opcode::Add: opcode = Opcode::AddScalar; break;
+		case Opcode::Subtract: opcode = a.isScalar ? Opcode::ScalarSubtract : Opcode::SubtractScalar; break;
+		case Opcode::Multiply: opcode = Opcode::MultiplyScalar; break;
+		case Opcode::Divide: opcode = a.isScalar ? Opcode::ScalarDivide : Opcode::DivideScalar; break;
+		default: break;
+		}
+		uint8_t destination = destinationFor(source);
+		emit(opcode, destination, source.index, scalar.index);
+		return Operand{ false, destination };
+	}
+
+	// Both operands in registers: reusing one of them for the result
+	uint8_t destination;
+	if (a.index != X_REGISTER)
+	{
+		destination = a.index;
+		freeRegister(b);
+	}
+	else if (b.index != X_REGISTER)
+	{
+		destination = b.index;
+	}
+	else
+	{
+		destination = allocateRegister();
+	}
+	emit(registerOpcode, destination, a.index, b.index);
+	return Operand{ false, destination };
+}
+
+BytecodeProgram::Operand BytecodeProgram::addConstant(float value)
+{
+	// Reusing the scalar if the constant is already in use
+	for (size_t i = 0; i < constants.size(); i++)
+	{
+		if (constants[i] == value)
+			return Operand{ true, (uint8_t)(firstConstantScalar + i) };
+	}
+	if (firstConstantScalar + constants.size() > 255)
+	{
+		throw ExpressionError("Function has too many different numbers", 0);
+	}
+	constants.push_back(value);
+	return Operand{ true, (uint8_t)(firstConstantScalar + constants.size() - 1) };
+}
+
+uint8_t BytecodeProgram::destinationFor(Operand operand)
+{
+	// Temporary registers can be overwritten, the x coordinates can not
+	if (!operand.isScalar && operand.index != X_REGISTER)
+		return operand.index;
+	return allocateRegister();
+}
+
+BytecodeProgram::Operand BytecodeProgram::toRegister(Operand operand)
+{
+	if (!operand.isScalar)
+		return operand;
+
+	uint8_t destination = allocateRegister();
+	emit(Opcode::LoadScalar, destination, 0, operand.index);
+	return Operand{ false, destination };
+}
+
+uint8_t BytecodeProgram::allocateRegister()
+{
+	if (!freeRegisters.empty())
+	{
+		// Taking the lowest free register, so the result tends to end up in register 0
+		std::vector<uint8_t>::iterator lowest = std::min_element(freeRegisters.begin(), freeRegisters.end());
+		uint8_t index = *lowest;
+		freeRegisters.erase(lowest);
+		return index;
+	}
+	if (registerCount >= X_REGISTER)
+	{
+		throw ExpressionError("Function is too complex", 0);
+	}
+	return (uint8_t)registerCount++;
+}
+
+void BytecodeProgram::freeRegister(Operand operand)
+{
+	if (!operand.isScalar && operand.index != X_REGISTER)
+		freeRegisters.push_back(operand.index);
+}
+
+void BytecodeProgram::emit(Opcode opcode, uint8_t destination, uint8_t a, uint8_t b)
+{
+	Instruction instruction;
+	instruction.opcode = opcode;
+	instruction.destination = destination;
+	instruction.a = a;
+	instruction.b = b;
+	instructions.push_back(instruction);
+}
+
+bool BytecodeProgram::isConstant(const ExpressionNode* node)
+{
+	if (node->type == ExpressionNode::Type::Input || node->type == ExpressionNode::Type::Variable)
+		return false;
+
+	for (const std::unique_ptr<ExpressionNode>& child : node->children)
+	{
+		if (!isConstant(child.get()))
+			return false;
+	}
+	return true;
+}
+
+double BytecodeProgram::evaluateConstant(const ExpressionNode* node)
+{
+	switch (node->type)
+	{
+	case ExpressionNode::Type::Number:
+	case ExpressionNode::Type::Constant:
+		return node->value;
+	default:
+		break;
+	}
+
+	double a = evaluateConstant(node->children[0].get());
+	double b = node->children.size() > 1 ? evaluateConstant(node->children[1].get()) : 0.0;
+
+	switch (node->type)
+	{
+	case ExpressionNode::Type::Negate: return -a;
+	case ExpressionNode::Type::Add: return a + b;
+	case ExpressionNode::Type::Subtract: return a - b;
+	case ExpressionNode::Type::Multiply: return a * b;
+	case ExpressionNode::Type::Divide: return a / b;
+	default: break;
+	}
+
+	switch (functionOpcode(node->name))
+	{
+	case Opcode::Sin: return std::sin(a);
+	case Opcode::Cos: return std::cos(a);
+	case Opcode::Tan: return std::tan(a);
+	case Opcode::Asin: return std::asin(a);
+	case Opcode::Acos: return std::acos(a);
+	case Opcode::Atan: return std::atan(a);
+	case Opcode::Exp: return std::exp(a);
+	case Opcode::Pow: return std::pow(a, b);
+	case Opcode::Sqrt: return std::sqrt(a);
+	case Opcode::Abs: return std::abs(a);
+	case Opcode::Floor: return std::floor(a);
+	case Opcode::Ceil: return std::ceil(a);
+	case Opcode::Min: return std::min(a, b);
+	case Opcode::Max: return std::max(a, b);
+	default: return 0.0;
+	}
+}
+
+BytecodeProgram::Opcode BytecodeProgram::functionOpcode(const std::string& name)
+{
+	if (name == "sin") return Opcode::Sin;
+	if (name == "cos") return Opcode::Cos;
+	if (name == "tan") return Opcode::Tan;
+	if (name == "asin") return Opcode::Asin;
+	if (name == "acos") return Opcode::Acos;
+	if (name == "atan") return Opcode::Atan;
+	if (name == "exp") return Opcode::Exp;
+	if (name == "pow") return Opcode::Pow;
+	if (name == "sqrt") return Opcode::Sqrt;
+	if (name == "abs") return Opcode::Abs;
+	if (name == "floor") return Opcode::Floor;
+	if (name == "ceil") return Opcode::Ceil;
+	if (name == "min") return Opcode::Min;
+	return Opcode::Max;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Expression.h"
+
+// A parsed function compiled to a compact register bytecode.
+// Every register holds a batch of points, so each instruction is dispatched once per batch
+// and runs a vectorized loop over all of its points.
+class BytecodeProgram
+{
+public:
+	// Number of points every instruction processes at once
+	static const unsigned int BATCH_SIZE = 256;
+
+	enum class Opcode : uint8_t
+	{
+		LoadScalar,		// destination = scalar b
+		Copy,			// destination = a
+		Negate,
+		Add,			// destination = a + b, with a and b registers
+		Subtract,
+		Multiply,
+		Divide,
+		AddScalar,		// destination = a + scalar b
+		SubtractScalar,	// destination = a - scalar b
+		ScalarSubtract,	// destination = scalar b - a
+		MultiplyScalar,
+		DivideScalar,	// destination = a / scalar b
+		ScalarDivide,	// destination = scalar b / a
+		Sin,
+		Cos,
+		Tan,
+		Asin,
+		Acos,
+		Atan,
+		Exp,
+		Pow,
+		Sqrt,
+		Abs,
+		Floor,
+		Ceil,
+		Min,
+		Max
+	};
+
+	struct Instruction
+	{
+		Opcode opcode;
+		uint8_t destination;
+		uint8_t a;
+		uint8_t b;
+	};
+
+	// Register that holds the x coordinates of the batch (read only)
+	static const uint8_t X_REGISTER = 255;
+
+	// Memory a single thread needs to execute the program
+	struct Workspace
+	{
+		std::vector<float> registers;
+		std::vector<float> scalars;
+		std::vector<float*> registerPointers;
+	};
+
+	BytecodeProgram();
+	// Compiles the expression, throws an ExpressionError if it needs too many registers or scalars
+	BytecodeProgram(const Expression& expression);
+
+	// Set up a workspace for executing with the given values for the user variables, in the order of the expression's variables
+	void prepare(Workspace& workspace, const float* variables) const;
+
+	// Calculate the function for count (at most BATCH_SIZE) points with the given x coordinates and z coordinate
+	void execute(Workspace& workspace, const float* x, float z, float* out, unsigned int count) const;
+
+	// Get the instructions
+	const std::vector<Instruction>& getInstructions() const;
+	// Get the number of batch sized registers the program uses
+	unsigned int getRegisterCount() const;
+	// Get a readable listing of the instructions
+	std::string disassemble() const;
+
+	// Scalars: z, then the user variables, then the constants
+	static const uint8_t Z_SCALAR = 0;
+	static const uint8_t FIRST_VARIABLE_SCALAR = 1;
+
+	// Get the constant values, stored in the scalars from getFirstConstantScalar on
+	const std::vector<float>& getConstants() const;
+	uint8_t getFirstConstantScalar() const;
+	// Get the number of scalars: z, the variables and the constants
+	unsigned int getScalarCount() const;
+
+private:
+	// An intermediate result while compiling: a register or a scalar
+	struct Operand
+	{
+		bool isScalar;
+		uint8_t index;
+	};
+
+	std::vector<Instruction> instructions;
+	std::vector<float> constants;
+	unsigned int registerCount = 1;
+	// Names of the variables, for disassembling
+	std::vector<std::string> variableNames;
+	uint8_t firstConstantScalar = FIRST_VARIABLE_SCALAR;
+
+	// Registers that are not in use while compiling
+	std::vector<uint8_t> freeRegisters;
+
+	Operand compileNode(const ExpressionNode* node);
+	Operand compileBinary(const ExpressionNode* node, Opcode registerOpcode);
+	Operand addConstant(float value);
+
+	// Get a register to write the result of an operation on the operand into
+	uint8_t destinationFor(Operand operand);
+	// Make sure the operand is in a register, loading it if it is a scalar
+	Operand toRegister(Operand operand);
+	uint8_t allocateRegister();
+	void freeRegister(Operand operand);
+	void emit(Opcode opcode, uint8_t destination, uint8_t a, uint8_t b);
+
+	// Whether the node only depends on numbers and constants
+	static bool isConstant(const ExpressionNode* node);
+	// Calculate a node that only depends on numbers and constants
+	static double evaluateConstant(const ExpressionNode* node);
+	// Get the opcode for a function name
+	static Opcode functionOpcode(const std::string& name);
+};
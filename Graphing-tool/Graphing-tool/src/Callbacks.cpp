@@ -1,6 +1,7 @@
 #include "Callbacks.h"
 
 Camera* Callbacks::camera;
+unsigned int Callbacks::eventCount = 0;
 
 void Callbacks::setCamera(Camera* camera)
 {
@@ -20,6 +21,7 @@ void Callbacks::framebuffer_size_callback(GLFWwindow* window, int width, int hei
 
 void Callbacks::framebuffer_size_callbackImpl(GLFWwindow* window, int width, int height)
 {
+    eventCount++;
     glViewport(0, 0, width, height);
 }
 
@@ -31,4 +33,56 @@ void Callbacks::mouseCallback(GLFWwindow* window, double xpos, double ypos)
 void Callbacks::mouseCallbackImpl(GLFWwindow* window, double xpos, double ypos)
 {
     camera->mouseCallback(window, xpos, ypos);
+}
+
+void Callbacks::installEventCallbacks(GLFWwindow* window)
+{
+    glfwSetCursorPosCallback(window, &Callbacks::cursor_position_callback);
+    glfwSetMouseButtonCallback(window, &Callbacks::mouse_button_callback);
+    glfwSetScrollCallback(window, &Callbacks::scroll_callback);
+    glfwSetKeyCallback(window, &Callbacks::key_callback);
+    glfwSetCharCallback(window, &Callbacks::char_callback);
+    glfwSetWindowRefreshCallback(window, &Callbacks::window_refresh_callback);
+    glfwSetWindowFocusCallback(window, &Callbacks::window_focus_callback);
+}
+
+unsigned int Callbacks::getEventCount()
+{
+    return eventCount;
+}
+
+void Callbacks::cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    eventCount++;
+}
+
+void Callbacks::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    eventCount++;
+}
+
+void Callbacks::scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    eventCount++;
+}
+
+void Callbacks::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    eventCount++;
+}
+
+void Callbacks::char_callback(GLFWwindow* window, unsigned int codepoint)
+{
+    eventCount++;
+}
+
+void Callbacks::window_refresh_callback(GLFWwindow* window)
+{
+    // The window contents were damaged, e.g. by another window moving over it
+    eventCount++;
+}
+
+void Callbacks::window_focus_callback(GLFWwindow* window, int focused)
+{
+    eventCount++;
 }
\ No newline at end of file
@@ -21,8 +21,22 @@ public:
     static void mouseCallback(GLFWwindow* window, double xpos, double ypos);
     void mouseCallbackImpl(GLFWwindow* window, double xpos, double ypos);
 
+    // Count every input and window event, so the render loop can tell whether anything happened.
+    // Must be installed before the ImGui backend, which then calls these after its own callbacks.
+    static void installEventCallbacks(GLFWwindow* window);
+    static unsigned int getEventCount();
+
+    static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
+    static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+    static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+    static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void char_callback(GLFWwindow* window, unsigned int codepoint);
+    static void window_refresh_callback(GLFWwindow* window);
+    static void window_focus_callback(GLFWwindow* window, int focused);
+
 private:
     static Camera* camera;
+    static unsigned int eventCount;
 
     Callbacks(void)
     {
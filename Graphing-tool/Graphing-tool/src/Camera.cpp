@@ -91,6 +91,24 @@ float Camera::getYaw()
 	return yaw;
 }
 
+void Camera::setPosition(glm::vec3 position)
+{
+	this->position = position;
+}
+
+void Camera::setRotation(float pitch, float yaw)
+{
+	this->pitch = pitch;
+	this->yaw = yaw;
+
+	// Setting the new vectors
+	glm::vec3 direction;
+	direction.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+	direction.y = sin(glm::radians(pitch));
+	direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+	forward = glm::normalize(direction);
+}
+
 float* Camera::getCameraSpeedPointer()
 {
 	return &cameraSpeed;
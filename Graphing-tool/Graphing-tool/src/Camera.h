@@ -33,6 +33,10 @@ public:
 	float getPitch();
 	float getYaw();
 
+	// Set the camera position, rotation (in degrees)
+	void setPosition(glm::vec3 position);
+	void setRotation(float pitch, float yaw);
+
 	float* getCameraSpeedPointer();
 	float* getFovPointer();
 	float* getSensitivityPointer();
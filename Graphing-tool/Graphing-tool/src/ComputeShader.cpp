@@ -1,8 +1,15 @@
 #include "ComputeShader.h"
 
-ComputeShader::ComputeShader(const char* shaderPath)
+#include <algorithm>
+#include <cstdio>
+
+#include "Expression.h"
+
+ComputeShader::ComputeShader(const char* shaderPath, glm::uvec2 workgroupSize)
+	: workgroupSize(workgroupSize)
 {
 	std::string shaderCode = readFile(shaderPath);
+	insertWorkgroupSize(shaderCode);
 	const char* shaderCodeChars = shaderCode.c_str();
 
 
@@ -22,23 +29,56 @@ ComputeShader::ComputeShader(const char* shaderPath)
 	glDeleteShader(shader);
 }
 
-ComputeShader::ComputeShader(std::string& function, const char* shaderPath, bool throwError)
+ComputeShader::ComputeShader(std::string& function, const char* shaderPath, bool throwError, glm::uvec2 workgroupSize, bool deferLink,
+	const std::vector<std::pair<unsigned int, float>>& constants)
+	: workgroupSize(workgroupSize)
 {
 	std::string shaderCode = readFile(shaderPath);
-	std::cout << replace(shaderCode, "$function", function);
+	insertWorkgroupSize(shaderCode);
+	insertVariableCount(shaderCode, function);
+	std::string functionCode = functionToGLSL(function, throwError);
+	insertConstants(functionCode, constants);
+
+	// Loading a binary of the same function and template instead of compiling, if there is one.
+	// Versions with baked constants only fit one set of variable values, they would push functions out of the cache.
+	ID = glCreateProgram();
+	if (constants.empty() && loadCachedProgram(functionCode, shaderCode))
+	{
+		finishLink(throwError);
+		return;
+	}
+
+	std::cout << replace(shaderCode, "$function", functionCode);
 	const char* shaderCodeChars = shaderCode.c_str();
 
 	/* Compiling the shaders */
 
 	unsigned int shader;
-	shader = compileShader(GL_COMPUTE_SHADER, shaderCodeChars);
+	shader = compileShader(GL_COMPUTE_SHADER, shaderCodeChars, !deferLink);
 
 
 	/* Creating the shader program */
 
-	ID = glCreateProgram();
 	glAttachShader(ID, shader);
-	linkProgram(throwError);
+	if (deferLink)
+	{
+		// Compile errors show up in the link status
+		startLink();
+	}
+	else
+	{
+		try
+		{
+			linkProgram(throwError);
+		}
+		catch (const std::exception&)
+		{
+			// Without a constructed shader nobody else can delete the program
+			glDeleteShader(shader);
+			glDeleteProgram(ID);
+			throw;
+		}
+	}
 
 	// delete the shaders as they're linked into our program now and no longer necessary
 	glDeleteShader(shader);
@@ -47,4 +87,59 @@ ComputeShader::ComputeShader(std::string& function, const char* shaderPath, bool
 ComputeShader::~ComputeShader()
 {
 	std::cout << "Compute shader destroyed." << std::endl;
-}
\ No newline at end of file
+}
+
+void ComputeShader::dispatch(unsigned int width, unsigned int height)
+{
+	glDispatchCompute((width + workgroupSize.x - 1) / workgroupSize.x, (height + workgroupSize.y - 1) / workgroupSize.y, 1);
+}
+
+void ComputeShader::dispatch(unsigned int width, unsigned int height, unsigned int depth)
+{
+	glDispatchCompute((width + workgroupSize.x - 1) / workgroupSize.x, (height + workgroupSize.y - 1) / workgroupSize.y, depth);
+}
+
+glm::uvec2 ComputeShader::getWorkgroupSize() const
+{
+	return workgroupSize;
+}
+
+void ComputeShader::insertWorkgroupSize(std::string& shaderCode)
+{
+	replace(shaderCode, "$workgroupSizeX", std::to_string(workgroupSize.x));
+	replace(shaderCode, "$workgroupSizeY", std::to_string(workgroupSize.y));
+}
+
+void ComputeShader::insertVariableCount(std::string& shaderCode, const std::string& function)
+{
+	if (shaderCode.find("$variableCount") == std::string::npos)
+		return;
+
+	// Arrays can not be empty
+	size_t count = 1;
+	try
+	{
+		count = std::max<size_t>(Expression(function).getVariables().size(), 1);
+	}
+	catch (const ExpressionError&)
+	{
+		// The function is replaced by 0.0, which uses no variables
+	}
+	replace(shaderCode, "$variableCount", std::to_string(count));
+}
+
+void ComputeShader::insertConstants(std::string& functionCode, const std::vector<std::pair<unsigned int, float>>& constants)
+{
+	for (const std::pair<unsigned int, float>& constant : constants)
+	{
+		// Enough digits to get the exact float back, always written as a float literal
+		char value[32];
+		snprintf(value, sizeof(value), "%.9g", constant.second);
+		std::string literal(value);
+		if (literal.find_first_of(".e") == std::string::npos)
+			literal += ".0";
+
+		// The closing bracket keeps variables[1] from matching variables[10]
+		replace(functionCode, "variables[" + std::to_string(constant.first) + "]", "(" + literal + ")");
+	}
+}
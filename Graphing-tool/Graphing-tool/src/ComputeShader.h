@@ -2,11 +2,33 @@
 
 #include "AbstractShader.h"
 
+#include <utility>
+#include <vector>
+
 class ComputeShader : public AbstractShader
 {
 public:
-	ComputeShader(const char* shaderPath);
-	ComputeShader(std::string& function, const char* shaderPath, bool throwError);
+	// The workgroup size replaces $workgroupSizeX and $workgroupSizeY in the shader code
+	ComputeShader(const char* shaderPath, glm::uvec2 workgroupSize = glm::uvec2(8, 8));
+	// With deferLink the program is only handed to the driver, call finishLink once isLinkComplete returns true.
+	// Every constant (variable index and value) replaces the reads of that variable, so the driver can fold it.
+	ComputeShader(std::string& function, const char* shaderPath, bool throwError, glm::uvec2 workgroupSize = glm::uvec2(8, 8), bool deferLink = false,
+		const std::vector<std::pair<unsigned int, float>>& constants = std::vector<std::pair<unsigned int, float>>());
 	~ComputeShader();
-};
 
+	// Run the shader once for every point of a width * height grid,
+	// rounding the number of workgroups up so the whole grid is covered
+	void dispatch(unsigned int width, unsigned int height);
+	// The same for depth grids at once, one workgroup deep each
+	void dispatch(unsigned int width, unsigned int height, unsigned int depth);
+
+	glm::uvec2 getWorkgroupSize() const;
+
+private:
+	glm::uvec2 workgroupSize;
+
+	void insertWorkgroupSize(std::string& shaderCode);
+	// Templates that copy the variables into an array replace $variableCount with the number of variables of the function
+	void insertVariableCount(std::string& shaderCode, const std::string& function);
+	void insertConstants(std::string& functionCode, const std::vector<std::pair<unsigned int, float>>& constants);
+};
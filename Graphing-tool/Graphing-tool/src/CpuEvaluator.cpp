@@ -0,0 +1,126 @@
+#include "CpuEvaluator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "SimdMath.h"
+
+CpuEvaluator::CpuEvaluator(unsigned int threadCount)
+	: threadPool(threadCount)
+{
+	workspaces.resize(threadPool.getThreadCount());
+	lanes.resize(threadPool.getThreadCount());
+}
+
+void CpuEvaluator::setFunction(const std::string& function)
+{
+	// Compiling before replacing anything, so an invalid function keeps the old one
+	Expression expression(function);
+	program = BytecodeProgram(expression);
+	expressionSource = expression.toGLSL();
+
+	updateJitFunction();
+}
+
+void CpuEvaluator::calculate(float* heights, unsigned int size, float scale, float graphWidth, const float* variables,
+	float centerX, float centerZ)
+{
+	if (size < 2)
+		return;
+
+	for (BytecodeProgram::Workspace& workspace : workspaces)
+	{
+		program.prepare(workspace, variables);
+	}
+
+	// Keeping a reference so the native code stays alive during the calculation
+	std::shared_ptr<JitFunction> jit = jitFunction;
+	if (jit)
+	{
+		for (size_t i = 0; i < workspaces.size(); i++)
+		{
+			jit->broadcastScalars(workspaces[i].scalars, scale, lanes[i]);
+		}
+	}
+
+	// Same coordinates as the compute shader: [-1, 1] scaled by scale and graph width, around the center
+	float offset = 2.0f / (float)(size - 1);
+	xValues.resize(size);
+	for (unsigned int cx = 0; cx < size; cx++)
+	{
+		xValues[cx] = centerX + ((float)cx * offset - 1.0f) * scale * graphWidth;
+	}
+
+	// Every row is a task for the thread pool, and is executed in batches
+	threadPool.parallelFor(size, [&](unsigned int cz, unsigned int thread)
+	{
+		float z = centerZ + ((float)cz * offset - 1.0f) * scale * graphWidth;
+		float* row = heights + (size_t)cz * size;
+
+		if (jit)
+		{
+			// Only the z lane changes between rows
+			JitFunction::Lane& zLane = lanes[thread][BytecodeProgram::Z_SCALAR];
+			for (int i = 0; i < 8; i++)
+				zLane.values[i] = z;
+
+			// The compiled code divides by scale itself
+			jit->execute(xValues.data(), row, size, lanes[thread].data());
+			return;
+		}
+
+		for (unsigned int start = 0; start < size; start += BytecodeProgram::BATCH_SIZE)
+		{
+			unsigned int count = std::min(size - start, (unsigned int)BytecodeProgram::BATCH_SIZE);
+			program.execute(workspaces[thread], &xValues[start], z, row + start, count);
+
+			// Dividing by scale like the compute shader
+			SimdMath::divide(row + start, scale, row + start, count);
+		}
+	});
+}
+
+unsigned int CpuEvaluator::getThreadCount() const
+{
+	return threadPool.getThreadCount();
+}
+
+const BytecodeProgram& CpuEvaluator::getProgram() const
+{
+	return program;
+}
+
+void CpuEvaluator::setJitEnabled(bool enabled)
+{
+	jitEnabled = enabled;
+	updateJitFunction();
+}
+
+bool CpuEvaluator::isJitActive() const
+{
+	return jitFunction != nullptr;
+}
+
+const JitCompiler& CpuEvaluator::getJitCompiler() const
+{
+	return jitCompiler;
+}
+
+void CpuEvaluator::updateJitFunction()
+{
+	jitFunction = nullptr;
+
+	if (!jitEnabled || !JitFunction::isSupported())
+		return;
+
+	try
+	{
+		jitFunction = jitCompiler.compile(program, expressionSource);
+	}
+	catch (const std::runtime_error& e)
+	{
+		// The interpreter still works, so this is not fatal
+		std::cout << "Could not compile function to native code: " << e.what() << std::endl;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BytecodeProgram.h"
+#include "JitCompiler.h"
+#include "ThreadPool.h"
+
+// Calculates the graph heights on the CPU, for machines without a usable compute shader.
+// The function is compiled to bytecode, rows of the grid are spread over a thread pool,
+// and every instruction runs over a whole batch of points at once using vectorized math.
+// Optionally the bytecode is compiled further to native code.
+class CpuEvaluator
+{
+public:
+	// Uses one thread per hardware thread if threadCount is 0
+	CpuEvaluator(unsigned int threadCount = 0);
+
+	// Set the function to evaluate, throws an ExpressionError if it is invalid
+	void setFunction(const std::string& function);
+
+	// Calculate the heights of a size * size grid into heights,
+	// with the same layout and values as the calculator compute shader writes into its buffer.
+	// variables holds the values of the user variables, in the order of the function's variables.
+	// The grid is centered on (centerX, centerZ) in function space.
+	void calculate(float* heights, unsigned int size, float scale, float graphWidth, const float* variables,
+		float centerX = 0.0f, float centerZ = 0.0f);
+
+	// Get the number of threads used for calculating
+	unsigned int getThreadCount() const;
+
+	// Get the compiled function
+	const BytecodeProgram& getProgram() const;
+
+	// Enable or disable compiling the function to native code.
+	// Falls back to the bytecode interpreter if native code is not supported.
+	void setJitEnabled(bool enabled);
+	// Whether the function is currently executed as native code
+	bool isJitActive() const;
+
+	// Get the cache of compiled native functions
+	const JitCompiler& getJitCompiler() const;
+
+private:
+	BytecodeProgram program;
+	// Generated GLSL of the function, which identifies it for the native code cache
+	std::string expressionSource;
+
+	bool jitEnabled = false;
+	JitCompiler jitCompiler;
+	std::shared_ptr<JitFunction> jitFunction;
+
+	// Compile the current program to native code if enabled
+	void updateJitFunction();
+
+	ThreadPool threadPool;
+	// Registers and scalars for every thread
+	std::vector<BytecodeProgram::Workspace> workspaces;
+	// Broadcast scalars for the native code of every thread
+	std::vector<std::vector<JitFunction::Lane>> lanes;
+	// x coordinates of every column of the grid
+	std::vector<float> xValues;
+};
@@ -0,0 +1,371 @@
+#include "Expression.h"
+
+#include <algorithm>
+#include <cctype>
+
+// All functions that may be used, with their number of arguments
+static const struct
+{
+	const char* name;
+	int argumentCount;
+} availableFunctions[] = {
+	{ "sin", 1 },
+	{ "cos", 1 },
+	{ "tan", 1 },
+	{ "asin", 1 },
+	{ "acos", 1 },
+	{ "atan", 1 },
+	{ "exp", 1 },
+	{ "pow", 2 },
+	{ "sqrt", 1 },
+	{ "abs", 1 },
+	{ "floor", 1 },
+	{ "ceil", 1 },
+	{ "min", 2 },
+	{ "max", 2 }
+};
+
+#define PI 3.14159265359
+
+ExpressionError::ExpressionError(const std::string& message, size_t position)
+	: std::runtime_error("Position " + std::to_string(position + 1) + ": " + message),
+	position(position)
+{
+}
+
+size_t ExpressionError::getPosition() const
+{
+	return position;
+}
+
+Expression::Expression(const std::string& function)
+{
+	tokenize(function);
+
+	root = parseSum();
+
+	// Everything must have been consumed by now
+	if (tokens[current].type != Token::Type::End)
+	{
+		throw ExpressionError("Unexpected '" + tokens[current].text + "'", tokens[current].position);
+	}
+
+	// The tokens are no longer required after parsing
+	tokens.clear();
+
+	std::sort(variables.begin(), variables.end());
+	variables.erase(std::unique(variables.begin(), variables.end()), variables.end());
+	indexVariables(root.get());
+}
+
+std::string Expression::toGLSL() const
+{
+	return nodeToGLSL(root.get());
+}
+
+const ExpressionNode* Expression::getRoot() const
+{
+	return root.get();
+}
+
+const std::vector<std::string>& Expression::getVariables() const
+{
+	return variables;
+}
+
+int Expression::getFunctionArgumentCount(const std::string& name)
+{
+	for (const auto& function : availableFunctions)
+	{
+		if (name == function.name)
+		{
+			return function.argumentCount;
+		}
+	}
+	// No function with this name
+	return -1;
+}
+
+void Expression::tokenize(const std::string& function)
+{
+	size_t i = 0;
+	while (i < function.length())
+	{
+		char character = function[i];
+
+		// Skipping whitespace
+		if (std::isspace((unsigned char)character))
+		{
+			i++;
+			continue;
+		}
+
+		Token token;
+		token.position = i;
+
+		// Numbers: digits with at most one decimal point
+		if (std::isdigit((unsigned char)character) || character == '.')
+		{
+			bool decimalPoint = false;
+			while (i < function.length() && (std::isdigit((unsigned char)function[i]) || function[i] == '.'))
+			{
+				if (function[i] == '.')
+				{
+					if (decimalPoint)
+						throw ExpressionError("Number has more than one decimal point", i);
+					decimalPoint = true;
+				}
+				i++;
+			}
+			token.type = Token::Type::Number;
+			token.text = function.substr(token.position, i - token.position);
+			if (token.text == ".")
+				throw ExpressionError("Expected a digit", token.position);
+		}
+		// Identifiers: functions, inputs, variables and constants
+		else if (std::isalpha((unsigned char)character) || character == '_')
+		{
+			while (i < function.length() && (std::isalnum((unsigned char)function[i]) || function[i] == '_'))
+			{
+				i++;
+			}
+			token.type = Token::Type::Identifier;
+			token.text = function.substr(token.position, i - token.position);
+		}
+		else
+		{
+			switch (character)
+			{
+			case '+': case '-': case '*': case '/':
+				token.type = Token::Type::Operator;
+				break;
+			case '(':
+				token.type = Token::Type::LeftParenthesis;
+				break;
+			case ')':
+				token.type = Token::Type::RightParenthesis;
+				break;
+			case ',':
+				token.type = Token::Type::Comma;
+				break;
+			default:
+				throw ExpressionError(std::string("Unknown character '") + character + "'", i);
+			}
+			token.text = std::string(1, character);
+			i++;
+		}
+
+		tokens.push_back(token);
+	}
+
+	// Marking the end so the parser never has to check bounds
+	Token end;
+	end.type = Token::Type::End;
+	end.text = "end of function";
+	end.position = function.length();
+	tokens.push_back(end);
+}
+
+std::unique_ptr<ExpressionNode> Expression::parseSum()
+{
+	std::unique_ptr<ExpressionNode> left = parseProduct();
+
+	while (tokens[current].type == Token::Type::Operator
+		&& (tokens[current].text == "+" || tokens[current].text == "-"))
+	{
+		std::unique_ptr<ExpressionNode> node(new ExpressionNode());
+		node->type = tokens[current].text == "+" ? ExpressionNode::Type::Add : ExpressionNode::Type::Subtract;
+		current++;
+
+		node->children.push_back(std::move(left));
+		node->children.push_back(parseProduct());
+		left = std::move(node);
+	}
+	return left;
+}
+
+std::unique_ptr<ExpressionNode> Expression::parseProduct()
+{
+	std::unique_ptr<ExpressionNode> left = parseUnary();
+
+	while (tokens[current].type == Token::Type::Operator
+		&& (tokens[current].text == "*" || tokens[current].text == "/"))
+	{
+		std::unique_ptr<ExpressionNode> node(new ExpressionNode());
+		node->type = tokens[current].text == "*" ? ExpressionNode::Type::Multiply : ExpressionNode::Type::Divide;
+		current++;
+
+		node->children.push_back(std::move(left));
+		node->children.push_back(parseUnary());
+		left = std::move(node);
+	}
+	return left;
+}
+
+std::unique_ptr<ExpressionNode> Expression::parseUnary()
+{
+	if (tokens[current].type == Token::Type::Operator)
+	{
+		// Unary plus does nothing
+		if (tokens[current].text == "+")
+		{
+			current++;
+			return parseUnary();
+		}
+		if (tokens[current].text == "-")
+		{
+			current++;
+			std::unique_ptr<ExpressionNode> node(new ExpressionNode());
+			node->type = ExpressionNode::Type::Negate;
+			node->children.push_back(parseUnary());
+			return node;
+		}
+	}
+	return parsePrimary();
+}
+
+std::unique_ptr<ExpressionNode> Expression::parsePrimary()
+{
+	const Token& token = tokens[current];
+
+	switch (token.type)
+	{
+	case Token::Type::Number:
+	{
+		current++;
+		std::unique_ptr<ExpressionNode> node(new ExpressionNode());
+		node->type = ExpressionNode::Type::Number;
+		node->value = std::stod(token.text[0] == '.' ? "0" + token.text : token.text);
+		node->name = token.text;
+		return node;
+	}
+	case Token::Type::Identifier:
+		current++;
+		return parseIdentifier(token);
+	case Token::Type::LeftParenthesis:
+	{
+		current++;
+		std::unique_ptr<ExpressionNode> node = parseSum();
+		expect(Token::Type::RightParenthesis, "')'");
+		return node;
+	}
+	case Token::Type::End:
+		throw ExpressionError("Unexpected end of function", token.position);
+	default:
+		throw ExpressionError("Unexpected '" + token.text + "'", token.position);
+	}
+}
+
+std::unique_ptr<ExpressionNode> Expression::parseIdentifier(const Token& token)
+{
+	std::unique_ptr<ExpressionNode> node(new ExpressionNode());
+	node->name = token.text;
+
+	// Function call
+	int argumentCount = getFunctionArgumentCount(token.text);
+	if (argumentCount != -1)
+	{
+		node->type = ExpressionNode::Type::Function;
+		expect(Token::Type::LeftParenthesis, "'(' after function name");
+		for (int i = 0; i < argumentCount; i++)
+		{
+			if (i > 0)
+				expect(Token::Type::Comma, "','");
+			node->children.push_back(parseSum());
+		}
+		if (tokens[current].type == Token::Type::Comma)
+		{
+			throw ExpressionError(token.text + " takes " + std::to_string(argumentCount)
+				+ (argumentCount == 1 ? " argument" : " arguments"), tokens[current].position);
+		}
+		expect(Token::Type::RightParenthesis, "')'");
+		return node;
+	}
+
+	if (token.text == "x" || token.text == "z")
+	{
+		node->type = ExpressionNode::Type::Input;
+		return node;
+	}
+	if (token.text == "pi")
+	{
+		node->type = ExpressionNode::Type::Constant;
+		node->value = PI;
+		return node;
+	}
+	// A name followed by a parenthesis is meant to be a function, not a variable
+	if (tokens[current].type == Token::Type::LeftParenthesis)
+	{
+		throw ExpressionError("Unknown function '" + token.text + "'", token.position);
+	}
+
+	// Every other name is a user variable
+	node->type = ExpressionNode::Type::Variable;
+	variables.push_back(token.text);
+	return node;
+}
+
+void Expression::indexVariables(ExpressionNode* node)
+{
+	if (node->type == ExpressionNode::Type::Variable)
+	{
+		node->index = (unsigned int)(std::lower_bound(variables.begin(), variables.end(), node->name) - variables.begin());
+	}
+	for (std::unique_ptr<ExpressionNode>& child : node->children)
+	{
+		indexVariables(child.get());
+	}
+}
+
+const Expression::Token& Expression::expect(Token::Type type, const char* description)
+{
+	const Token& token = tokens[current];
+	if (token.type != type)
+	{
+		throw ExpressionError(std::string("Expected ") + description + " but found '" + token.text + "'", token.position);
+	}
+	current++;
+	return token;
+}
+
+std::string Expression::nodeToGLSL(const ExpressionNode* node) const
+{
+	switch (node->type)
+	{
+	case ExpressionNode::Type::Number:
+		// Always writing a float literal, so that for example 1/2 is not an integer division
+		if (node->name.find('.') == std::string::npos)
+			return node->name + ".0";
+		if (node->name[0] == '.')
+			return "0" + node->name;
+		return node->name;
+	case ExpressionNode::Type::Input:
+	case ExpressionNode::Type::Constant:
+		return node->name;
+	case ExpressionNode::Type::Variable:
+		// Names of variables can clash with GLSL, so they are only used on the CPU
+		return "variables[" + std::to_string(node->index) + "]";
+	case ExpressionNode::Type::Negate:
+		return "(-" + nodeToGLSL(node->children[0].get()) + ")";
+	case ExpressionNode::Type::Add:
+		return "(" + nodeToGLSL(node->children[0].get()) + " + " + nodeToGLSL(node->children[1].get()) + ")";
+	case ExpressionNode::Type::Subtract:
+		return "(" + nodeToGLSL(node->children[0].get()) + " - " + nodeToGLSL(node->children[1].get()) + ")";
+	case ExpressionNode::Type::Multiply:
+		return "(" + nodeToGLSL(node->children[0].get()) + " * " + nodeToGLSL(node->children[1].get()) + ")";
+	case ExpressionNode::Type::Divide:
+		return "(" + nodeToGLSL(node->children[0].get()) + " / " + nodeToGLSL(node->children[1].get()) + ")";
+	case ExpressionNode::Type::Function:
+	{
+		std::string code = node->name + "(";
+		for (size_t i = 0; i < node->children.size(); i++)
+		{
+			if (i > 0)
+				code += ", ";
+			code += nodeToGLSL(node->children[i].get());
+		}
+		return code + ")";
+	}
+	}
+	return "";
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+// Error thrown when a function string can not be parsed
+class ExpressionError : public std::runtime_error
+{
+public:
+	ExpressionError(const std::string& message, size_t position);
+
+	// Character index in the function string at which the error was found
+	size_t getPosition() const;
+
+private:
+	size_t position;
+};
+
+// A single node in the syntax tree of a parsed function
+struct ExpressionNode
+{
+	enum class Type
+	{
+		Number,		// Literal number, stored in value
+		Input,		// x or z
+		Variable,	// User variable, any name that is not a function, input or constant
+		Constant,	// Named constant (pi)
+		Negate,		// Unary minus, one child
+		Add,		// Binary operators, two children
+		Subtract,
+		Multiply,
+		Divide,
+		Function	// Function call, one child per argument
+	};
+
+	Type type;
+	// Value of a number or constant
+	double value = 0.0;
+	// Name of the input, variable, constant or function, or the number as it was typed
+	std::string name;
+	// Index of a variable in the variables of the expression
+	unsigned int index = 0;
+	std::vector<std::unique_ptr<ExpressionNode>> children;
+};
+
+// A function string parsed into a syntax tree.
+// Parsing happens entirely on the CPU, so invalid input is rejected
+// before any shader is compiled.
+class Expression
+{
+public:
+	// Parses the given function, throws an ExpressionError if it is invalid
+	Expression(const std::string& function);
+
+	// Generate GLSL code that calculates the function
+	std::string toGLSL() const;
+
+	// Get the root node of the syntax tree
+	const ExpressionNode* getRoot() const;
+
+	// Get the names of all user variables used in the function (sorted, no duplicates).
+	// The generated code reads variable i from variables[i], so their values are one contiguous array.
+	const std::vector<std::string>& getVariables() const;
+
+	// Get the number of arguments a function takes, or -1 if there is no function with that name
+	static int getFunctionArgumentCount(const std::string& name);
+
+private:
+	struct Token
+	{
+		enum class Type { Number, Identifier, Operator, LeftParenthesis, RightParenthesis, Comma, End };
+		Type type;
+		std::string text;
+		size_t position;
+	};
+
+	std::unique_ptr<ExpressionNode> root;
+	std::vector<std::string> variables;
+
+	// Parser state
+	std::vector<Token> tokens;
+	size_t current = 0;
+
+	// Split the function string into tokens
+	void tokenize(const std::string& function);
+
+	// Recursive descent parsing, from lowest to highest precedence
+	std::unique_ptr<ExpressionNode> parseSum();
+	std::unique_ptr<ExpressionNode> parseProduct();
+	std::unique_ptr<ExpressionNode> parseUnary();
+	std::unique_ptr<ExpressionNode> parsePrimary();
+	std::unique_ptr<ExpressionNode> parseIdentifier(const Token& token);
+
+	// Set the index of every variable node, once the variables are sorted
+	void indexVariables(ExpressionNode* node);
+
+	// Consume the next token, throwing an error if it is not of the expected type
+	const Token& expect(Token::Type type, const char* description);
+
+	std::string nodeToGLSL(const ExpressionNode* node) const;
+};
@@ -0,0 +1,239 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "imgui/imgui.h"
+
+void FrameStats::create()
+{
+	if (gpuEnabled)
+		return;
+
+	for (FrameQueries& queries : frameQueries)
+	{
+		glGenQueries(2, queries.queries);
+		queries.pending = false;
+	}
+	gpuEnabled = true;
+}
+
+void FrameStats::destroy()
+{
+	if (!gpuEnabled)
+		return;
+
+	for (FrameQueries& queries : frameQueries)
+	{
+		glDeleteQueries(2, queries.queries);
+		queries.queries[0] = queries.queries[1] = 0;
+		queries.pending = false;
+	}
+	gpuEnabled = false;
+}
+
+void FrameStats::beginFrame()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	intervalKnown = frameCount > 0 && !paused;
+	if (intervalKnown)
+		frameTime = std::chrono::duration<float, std::milli>(now - frameStart).count();
+	frameStart = now;
+	paused = false;
+
+	if (gpuEnabled)
+	{
+		// Only waits if the GPU is more than QUERY_FRAMES frames behind
+		FrameQueries& queries = frameQueries[frameCount % QUERY_FRAMES];
+		if (queries.pending)
+			resolve(queries, true);
+
+		queries.frame = frameCount;
+		glQueryCounter(queries.queries[0], GL_TIMESTAMP);
+	}
+}
+
+void FrameStats::endFrame(unsigned int calculations)
+{
+	float cpuTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+	Sample& sample = samples[frameCount % WINDOW_SIZE];
+	sample = Sample();
+	sample.frame = frameCount;
+	// Without a previous frame to measure from only the frame itself counts
+	sample.frameTime = intervalKnown ? frameTime : cpuTime;
+	sample.cpuTime = cpuTime;
+	sample.calculations = calculations;
+
+	if (gpuEnabled)
+	{
+		FrameQueries& queries = frameQueries[frameCount % QUERY_FRAMES];
+		glQueryCounter(queries.queries[1], GL_TIMESTAMP);
+		queries.pending = true;
+
+		// Picking up the GPU times of earlier frames that are done by now
+		for (FrameQueries& earlier : frameQueries)
+		{
+			if (earlier.pending && earlier.frame != frameCount)
+				resolve(earlier, false);
+		}
+	}
+
+	frameCount++;
+}
+
+void FrameStats::finish()
+{
+	for (FrameQueries& queries : frameQueries)
+	{
+		if (queries.pending)
+			resolve(queries, true);
+	}
+}
+
+void FrameStats::pause()
+{
+	paused = true;
+}
+
+FrameStats::Summary FrameStats::getFrameTimeSummary() const
+{
+	return summarize(&Sample::frameTime);
+}
+
+FrameStats::Summary FrameStats::getCpuTimeSummary() const
+{
+	return summarize(&Sample::cpuTime);
+}
+
+FrameStats::Summary FrameStats::getGpuTimeSummary() const
+{
+	return summarize(&Sample::gpuTime);
+}
+
+unsigned int FrameStats::getCalculationCount() const
+{
+	unsigned int count = 0;
+	size_t sampleCount = (size_t)std::min(frameCount, (unsigned long long)WINDOW_SIZE);
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		count += samples[i].calculations;
+	}
+	return count;
+}
+
+std::string FrameStats::getReport() const
+{
+	const char* names[3] = { "Frame", "CPU", "GPU" };
+	Summary summaries[3] = { getFrameTimeSummary(), getCpuTimeSummary(), getGpuTimeSummary() };
+
+	std::string report;
+	char line[160];
+	for (int i = 0; i < 3; i++)
+	{
+		const Summary& summary = summaries[i];
+		snprintf(line, sizeof(line), "%-5s ms: mean %.2f, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f (%u frames)\n",
+			names[i], summary.mean, summary.p50, summary.p95, summary.p99, summary.max, summary.count);
+		report += line;
+	}
+	snprintf(line, sizeof(line), "Height calculations: %u", getCalculationCount());
+	report += line;
+	return report;
+}
+
+void FrameStats::drawGui()
+{
+	ImGui::Text("%s", getReport().c_str());
+
+	if (ImGui::Button("Write frame statistics"))
+	{
+		writeMessage = writeCSV("frame_stats.csv") ? "Written to frame_stats.csv" : "Could not write frame_stats.csv";
+	}
+	if (!writeMessage.empty())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", writeMessage.c_str());
+	}
+}
+
+bool FrameStats::writeCSV(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	file << "frame,frame_ms,cpu_ms,gpu_ms,calculations\n";
+	unsigned long long first = frameCount > WINDOW_SIZE ? frameCount - WINDOW_SIZE : 0;
+	for (unsigned long long frame = first; frame < frameCount; frame++)
+	{
+		const Sample& sample = samples[frame % WINDOW_SIZE];
+		file << sample.frame << "," << sample.frameTime << "," << sample.cpuTime << ",";
+		// Left empty when the GPU time is unknown
+		if (sample.gpuTime >= 0.0f)
+			file << sample.gpuTime;
+		file << "," << sample.calculations << "\n";
+	}
+
+	return (bool)file;
+}
+
+bool FrameStats::resolve(FrameQueries& queries, bool wait)
+{
+	if (!wait)
+	{
+		int available = 0;
+		glGetQueryObjectiv(queries.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+	}
+
+	GLuint64 begin = 0, end = 0;
+	glGetQueryObjectui64v(queries.queries[0], GL_QUERY_RESULT, &begin);
+	glGetQueryObjectui64v(queries.queries[1], GL_QUERY_RESULT, &end);
+	queries.pending = false;
+
+	// The sample may already have left the window
+	Sample& sample = samples[queries.frame % WINDOW_SIZE];
+	if (sample.frame == queries.frame)
+		sample.gpuTime = (float)((double)(end - begin) / 1000000.0);
+	return true;
+}
+
+FrameStats::Summary FrameStats::summarize(float Sample::* value) const
+{
+	std::vector<float> values;
+	size_t sampleCount = (size_t)std::min(frameCount, (unsigned long long)WINDOW_SIZE);
+	values.reserve(sampleCount);
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		// Unknown values are negative
+		if (samples[i].*value >= 0.0f)
+			values.push_back(samples[i].*value);
+	}
+
+	Summary summary;
+	if (values.empty())
+		return summary;
+
+	std::sort(values.begin(), values.end());
+	double total = 0.0;
+	for (float v : values)
+		total += v;
+
+	// Nearest rank percentiles
+	auto percentile = [&values](float p)
+	{
+		size_t rank = (size_t)std::ceil(p * values.size());
+		return values[rank > 0 ? rank - 1 : 0];
+	};
+
+	summary.count = (unsigned int)values.size();
+	summary.mean = (float)(total / values.size());
+	summary.p50 = percentile(0.50f);
+	summary.p95 = percentile(0.95f);
+	summary.p99 = percentile(0.99f);
+	summary.max = values.back();
+	return summary;
+}
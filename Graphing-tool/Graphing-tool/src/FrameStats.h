@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Collects the frame time, CPU time, GPU time and number of height calculations of the last frames,
+// and summarises them as mean, percentiles and maximum to judge stutter instead of a single frame's FPS.
+// The GPU time of a frame is measured with timestamp queries and filled in once the results are available.
+class FrameStats
+{
+public:
+	// Number of frames the statistics are taken over
+	static const int WINDOW_SIZE = 600;
+
+	struct Summary
+	{
+		unsigned int count = 0;
+		float mean = 0.0f;
+		float p50 = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+		float max = 0.0f;
+	};
+
+	// Create the GPU queries, without them only CPU times are collected
+	void create();
+	void destroy();
+
+	// Mark the start and end of a frame, with the number of height calculations in the frame
+	void beginFrame();
+	void endFrame(unsigned int calculations);
+	// Wait for the GPU times of all frames that still miss them
+	void finish();
+	// Do not count the time until the next frame as frame time, e.g. while waiting for input
+	void pause();
+
+	// Summaries of the window in milliseconds: time between frames, CPU time of a frame and GPU time of a frame
+	Summary getFrameTimeSummary() const;
+	Summary getCpuTimeSummary() const;
+	Summary getGpuTimeSummary() const;
+	// Height calculations in the window
+	unsigned int getCalculationCount() const;
+
+	// Get the summaries as text
+	std::string getReport() const;
+	// Draw the summaries and a button to write them
+	void drawGui();
+
+	// Write every frame of the window as a row of comma separated values, returns whether the file could be written
+	bool writeCSV(const std::string& path) const;
+
+private:
+	// Frames whose GPU time can be waited on at once
+	static const int QUERY_FRAMES = 8;
+
+	struct Sample
+	{
+		unsigned long long frame = 0;
+		float frameTime = 0.0f;
+		float cpuTime = 0.0f;
+		// Negative while the GPU time is not known
+		float gpuTime = -1.0f;
+		unsigned int calculations = 0;
+	};
+
+	struct FrameQueries
+	{
+		unsigned int queries[2] = { 0, 0 };
+		unsigned long long frame = 0;
+		bool pending = false;
+	};
+
+	bool gpuEnabled = false;
+
+	// Samples by frame number modulo the window size
+	std::vector<Sample> samples = std::vector<Sample>(WINDOW_SIZE);
+	unsigned long long frameCount = 0;
+	FrameQueries frameQueries[QUERY_FRAMES];
+
+	std::chrono::steady_clock::time_point frameStart;
+	float frameTime = 0.0f;
+	// Whether frameTime holds the time since the previous frame
+	bool intervalKnown = false;
+	bool paused = false;
+	std::string writeMessage;
+
+	// Read the GPU time of a frame into its sample, returns false if it is not available and wait is false
+	bool resolve(FrameQueries& queries, bool wait);
+	Summary summarize(float Sample::* value) const;
+};
@@ -0,0 +1,62 @@
+#include "FrameUniforms.h"
+
+#include <cstring>
+
+void FrameUniforms::create()
+{
+	if (buffer != 0)
+		return;
+
+	// Every region has to start at a multiple of the offset alignment
+	int alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	regionSize = ((GLsizeiptr)sizeof(FrameData) + alignment - 1) / alignment * alignment;
+
+	// Immutable storage, mapped once for the lifetime of the buffer
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, regionSize * REGION_COUNT, NULL, flags);
+	mappedMemory = (unsigned char*)glMapNamedBufferRange(buffer, 0, regionSize * REGION_COUNT, flags);
+}
+
+void FrameUniforms::destroy()
+{
+	for (GLsync& fence : fences)
+	{
+		if (fence != 0)
+			glDeleteSync(fence);
+		fence = 0;
+	}
+	if (buffer != 0)
+	{
+		glUnmapNamedBuffer(buffer);
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	mappedMemory = nullptr;
+}
+
+void FrameUniforms::update(const FrameData& data)
+{
+	currentRegion = (currentRegion + 1) % REGION_COUNT;
+
+	// Only waits if the GPU is more than two frames behind
+	GLsync& fence = fences[currentRegion];
+	if (fence != 0)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	std::memcpy(mappedMemory + regionSize * currentRegion, &data, sizeof(FrameData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, buffer, regionSize * currentRegion, sizeof(FrameData));
+}
+
+void FrameUniforms::endFrame()
+{
+	GLsync& fence = fences[currentRegion];
+	if (fence != 0)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+// Uniforms shared by every program, matching the std140 Frame block in the vertex shaders
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	// Only rgb is used, vec3 takes the space of a vec4 in std140 anyway
+	glm::vec4 upperColor;
+	glm::vec4 lowerColor;
+	float graphWidth;
+	float verticalScale;
+	float padding[2];
+};
+
+// A persistently mapped uniform buffer holding the FrameData, written once per frame.
+// It is triple buffered: every frame writes its own region, waiting on a fence only if the GPU
+// is still reading that region from three frames ago.
+class FrameUniforms
+{
+public:
+	// Binding point of the Frame block
+	static const unsigned int BINDING = 0;
+
+	// Create the buffer, requires a current OpenGL context
+	void create();
+	void destroy();
+
+	// Write the data of the next frame and bind its region to the Frame block
+	void update(const FrameData& data);
+
+	// Mark the end of the draws that read the current region
+	void endFrame();
+
+private:
+	static const int REGION_COUNT = 3;
+
+	unsigned int buffer = 0;
+	unsigned char* mappedMemory = nullptr;
+	// Size of a region, rounded up to the uniform buffer offset alignment
+	GLsizeiptr regionSize = 0;
+	int currentRegion = 0;
+	GLsync fences[REGION_COUNT] = { 0, 0, 0 };
+};
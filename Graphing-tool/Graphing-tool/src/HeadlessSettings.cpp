@@ -0,0 +1,198 @@
+#include "HeadlessSettings.h"
+
+#include <iostream>
+#include <sstream>
+
+// Read comma separated numbers, returns whether exactly count numbers were read
+static bool parseFloats(const std::string& text, float* values, int count)
+{
+	std::stringstream stream(text);
+	std::string part;
+	int i = 0;
+	while (std::getline(stream, part, ','))
+	{
+		if (i >= count)
+			return false;
+		try
+		{
+			size_t end = 0;
+			values[i] = std::stof(part, &end);
+			if (end != part.size())
+				return false;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+		i++;
+	}
+	return i == count;
+}
+
+static bool parseInt(const std::string& text, int& value)
+{
+	try
+	{
+		size_t end = 0;
+		value = std::stoi(text, &end);
+		return end == text.size();
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+bool parseHeadlessSettings(int argc, char* argv[], int first, HeadlessSettings& settings)
+{
+	for (int i = first; i < argc; i++)
+	{
+		std::string argument(argv[i]);
+
+		// Flags without a value
+		if (argument == "--heights") { settings.writeHeights = true; continue; }
+		if (argument == "--no-images") { settings.writeImages = false; continue; }
+		if (argument == "--no-gl") { settings.noGL = true; continue; }
+		if (argument == "--smooth") { settings.smoothMesh = true; continue; }
+		if (argument == "--wireframe") { settings.wireframe = true; continue; }
+		if (argument == "--line-edges") { settings.lineEdges = true; continue; }
+		if (argument == "--vertex-pulling") { settings.vertexPulling = true; continue; }
+		if (argument == "--strips") { settings.strips = true; continue; }
+		if (argument == "--recalculate") { settings.recalculate = true; continue; }
+		if (argument == "--tiled") { settings.tiled = true; continue; }
+
+		// Everything else takes a value
+		if (i + 1 >= argc)
+		{
+			std::cout << "Missing value for " << argument << std::endl;
+			return false;
+		}
+		std::string value(argv[++i]);
+		bool valid = true;
+
+		if (argument == "--function")
+		{
+			settings.function = value;
+		}
+		else if (argument == "--variable")
+		{
+			// name=value, e.g. a=0.5 or speed=2
+			size_t equals = value.find('=');
+			float number = 0.0f;
+			valid = equals != std::string::npos && equals > 0 && parseFloats(value.substr(equals + 1), &number, 1);
+			if (valid)
+				settings.variables.push_back(std::make_pair(value.substr(0, equals), number));
+		}
+		else if (argument == "--sweep")
+		{
+			// name=from,to, e.g. a=0,2
+			size_t equals = value.find('=');
+			float range[2] = { 0.0f, 0.0f };
+			valid = equals != std::string::npos && equals > 0 && parseFloats(value.substr(equals + 1), range, 2);
+			if (valid)
+				settings.sweeps.push_back({ value.substr(0, equals), range[0], range[1] });
+		}
+		else if (argument == "--quality")
+		{
+			const char* names[4] = { "low", "medium", "high", "ultra" };
+			valid = false;
+			for (int level = 0; level < 4; level++)
+			{
+				if (value == names[level] || value == std::to_string(level))
+				{
+					settings.quality = level;
+					valid = true;
+				}
+			}
+		}
+		else if (argument == "--camera")
+		{
+			// x,y,z,pitch,yaw
+			float pose[5];
+			valid = parseFloats(value, pose, 5);
+			if (valid)
+			{
+				settings.cameraPosition[0] = pose[0];
+				settings.cameraPosition[1] = pose[1];
+				settings.cameraPosition[2] = pose[2];
+				settings.pitch = pose[3];
+				settings.yaw = pose[4];
+			}
+		}
+		else if (argument == "--orbit") valid = parseFloats(value, &settings.orbit, 1);
+		else if (argument == "--scale") valid = parseFloats(value, &settings.scale, 1) && settings.scale > 0.0f;
+		else if (argument == "--graph-width") valid = parseFloats(value, &settings.graphWidth, 1) && settings.graphWidth > 0.0f;
+		else if (argument == "--center") valid = parseFloats(value, settings.center, 2);
+		else if (argument == "--lod") valid = parseInt(value, settings.lodLevel) && settings.lodLevel >= 0 && settings.lodLevel <= 8;
+		else if (argument == "--vertical-scale") valid = parseFloats(value, &settings.verticalScale, 1);
+		else if (argument == "--frames") valid = parseInt(value, settings.frames) && settings.frames > 0;
+		else if (argument == "--width") valid = parseInt(value, settings.width) && settings.width > 0;
+		else if (argument == "--height") valid = parseInt(value, settings.height) && settings.height > 0;
+		else if (argument == "--output") settings.output = value;
+		else if (argument == "--stats") settings.statsOutput = value;
+		else
+		{
+			std::cout << "Unknown argument " << argument << std::endl;
+			return false;
+		}
+
+		if (!valid)
+		{
+			std::cout << "Invalid value for " << argument << ": " << value << std::endl;
+			return false;
+		}
+	}
+
+	if (settings.noGL)
+	{
+		// Without OpenGL a single frame of heights is calculated, options for frames or the GPU would be ignored
+		const char* unsupported = NULL;
+		if (!settings.sweeps.empty()) unsupported = "--sweep";
+		else if (settings.frames > 1) unsupported = "--frames";
+		else if (!settings.statsOutput.empty()) unsupported = "--stats";
+		else if (settings.recalculate) unsupported = "--recalculate";
+		else if (settings.tiled) unsupported = "--tiled";
+		else if (settings.lodLevel >= 0) unsupported = "--lod";
+		if (unsupported != NULL)
+		{
+			std::cout << unsupported << " can not be used with --no-gl" << std::endl;
+			return false;
+		}
+	}
+
+	if (settings.noGL && !settings.writeHeights)
+	{
+		// Images need OpenGL, so without it only the heights can be written
+		settings.writeImages = false;
+		settings.writeHeights = true;
+	}
+	return true;
+}
+
+void printHeadlessUsage()
+{
+	std::cout << "Usage: --headless [options]\n"
+		<< " --function <f>          function to plot\n"
+		<< " --variable <a=0.5>      value of a user variable, may be repeated\n"
+		<< " --sweep <a=0,2>         sweep a variable over the frames, calculated in one dispatch, may be repeated\n"
+		<< " --quality <low|medium|high|ultra>\n"
+		<< " --scale <s>, --graph-width <w>, --vertical-scale <v>\n"
+		<< " --center <x,z>          point of the function at the middle of the graph\n"
+		<< " --smooth, --wireframe   view modes\n"
+		<< " --line-edges            draw the edges in a second pass with lines\n"
+		<< " --vertex-pulling        draw without vertex and index buffers\n"
+		<< " --strips                index the mesh as triangle strips\n"
+		<< " --lod <level>           draw chunks of adaptive detail around the camera, finest level 0 to 8\n"
+		<< " --camera <x,y,z,pitch,yaw>\n"
+		<< " --orbit <degrees>       rotate the camera around the y-axis every frame\n"
+		<< " --frames <n>            number of frames to render\n"
+		<< " --recalculate           calculate the heights again every frame\n"
+		<< " --tiled                 calculate the heights from tiles of function values\n"
+		<< " --stats <file>          write frame time statistics to a CSV file\n"
+		<< " --width <w>, --height <h>\n"
+		<< " --output <prefix>       images are written to <prefix>_<frame>.ppm\n"
+		<< " --heights               also write the heights to <prefix>.pfm\n"
+		<< " --no-images             do not write images\n"
+		<< " --no-gl                 calculate on the CPU without OpenGL, only writes heights,\n"
+		<< "                         not with --sweep, --frames, --stats, --recalculate, --tiled or --lod" << std::endl;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Settings for rendering graphs without a visible window, read from the command line
+struct HeadlessSettings
+{
+	std::string function = "sin(x*z)/1.4 + cos((x+z)/2)*a+b";
+	// Names and values of user variables, variables that are not set are 0
+	std::vector<std::pair<std::string, float>> variables;
+	// Variables swept from one value to another over the frames, with the first and last value
+	struct Sweep
+	{
+		std::string name;
+		float from;
+		float to;
+	};
+	std::vector<Sweep> sweeps;
+
+	// Quality level: 0 (low) to 3 (ultra)
+	int quality = 1;
+	float scale = 3.0f;
+	float graphWidth = 1.0f;
+	// Point of the function at the middle of the graph, x and z
+	float center[2] = { 0.0f, 0.0f };
+	float verticalScale = 1.0f;
+	bool smoothMesh = false;
+	bool wireframe = false;
+	// Draw the edges in a second pass with lines, instead of in the same pass as the surface
+	bool lineEdges = false;
+	bool vertexPulling = false;
+	// Index the mesh as triangle strips instead of a triangle list
+	bool strips = false;
+	// Draw chunks of adaptive level of detail around the camera, down to this level, instead of the grid. -1 is off.
+	int lodLevel = -1;
+
+	// Camera pose, pitch and yaw in degrees
+	float cameraPosition[3] = { -3.0f, 2.0f, -2.0f };
+	float pitch = -30.0f;
+	float yaw = 35.0f;
+	// Degrees the camera rotates around the y-axis every frame
+	float orbit = 0.0f;
+
+	int frames = 1;
+	// Calculate the heights again every frame, to measure the calculation
+	bool recalculate = false;
+	// Calculate the heights from tiles of function values
+	bool tiled = false;
+	int width = 1200;
+	int height = 900;
+
+	// Images are written to <output>_<frame>.ppm, the heights to <output>.pfm
+	std::string output = "graph";
+	bool writeImages = true;
+	bool writeHeights = false;
+	// Frame statistics are written to this file as comma separated values if it is not empty
+	std::string statsOutput;
+	// Calculate on the CPU and only write the heights, without creating an OpenGL context
+	bool noGL = false;
+};
+
+// Parse the headless settings from the command line arguments, starting at argument first.
+// Returns false and prints the problem if an argument is invalid.
+bool parseHeadlessSettings(int argc, char* argv[], int first, HeadlessSettings& settings);
+
+// Print the available headless arguments
+void printHeadlessUsage();
@@ -0,0 +1,131 @@
+#include "HeightBuffer.h"
+
+void HeightBuffer::resize(unsigned int pointCount)
+{
+	if (pointCount == this->pointCount && buffers[0] != 0)
+		return;
+
+	// Immutable storage can not be resized, so the old buffers are replaced
+	destroy();
+	this->pointCount = pointCount;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(BUFFER_COUNT, buffers);
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		glNamedBufferStorage(buffers[i], pointCount * sizeof(float), nullptr, flags);
+		mappedMemory[i] = (float*)glMapNamedBufferRange(buffers[i], 0, pointCount * sizeof(float), flags);
+	}
+
+	allocationCount++;
+	writesSinceAllocation = 0;
+}
+
+void HeightBuffer::destroy()
+{
+	if (calculationFence != 0)
+		glDeleteSync(calculationFence);
+	calculationFence = 0;
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		if (fences[i] != 0)
+			glDeleteSync(fences[i]);
+		fences[i] = 0;
+
+		if (buffers[i] != 0)
+		{
+			glUnmapNamedBuffer(buffers[i]);
+			glDeleteBuffers(1, &buffers[i]);
+		}
+		buffers[i] = 0;
+		mappedMemory[i] = nullptr;
+	}
+}
+
+unsigned int HeightBuffer::next()
+{
+	currentBuffer = (currentBuffer + 1) % BUFFER_COUNT;
+
+	// The draws that last read this buffer were three frames ago, so this should hardly ever wait
+	GLsync& fence = fences[currentBuffer];
+	if (fence != 0)
+	{
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			waitCount++;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	writesSinceAllocation++;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, buffers[currentBuffer]);
+	return buffers[currentBuffer];
+}
+
+unsigned int HeightBuffer::current() const
+{
+	return buffers[currentBuffer];
+}
+
+void HeightBuffer::bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, buffers[currentBuffer]);
+}
+
+float* HeightBuffer::getMappedMemory() const
+{
+	return mappedMemory[currentBuffer];
+}
+
+void HeightBuffer::endFrame()
+{
+	if (buffers[currentBuffer] == 0)
+		return;
+
+	GLsync& fence = fences[currentBuffer];
+	if (fence != 0)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void HeightBuffer::submit()
+{
+	if (calculationFence != 0)
+		glDeleteSync(calculationFence);
+	calculationFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	// Without a flush the driver may hold the dispatch back until the draws are recorded
+	glFlush();
+}
+
+bool HeightBuffer::isReady()
+{
+	if (calculationFence == 0)
+		return true;
+
+	GLenum status = glClientWaitSync(calculationFence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(calculationFence);
+	calculationFence = 0;
+	return true;
+}
+
+unsigned int HeightBuffer::getAllocationCount() const
+{
+	return allocationCount;
+}
+
+unsigned int HeightBuffer::getWritesSinceAllocation() const
+{
+	return writesSinceAllocation;
+}
+
+unsigned int HeightBuffer::getWaitCount() const
+{
+	return waitCount;
+}
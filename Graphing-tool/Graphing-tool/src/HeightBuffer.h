@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Ring of shader storage buffers holding the graph heights.
+// The storage is immutable and only allocated again when the number of points changes.
+// Every calculation writes the next buffer of the ring, so it never has to wait for the draws
+// of the previous frame that still read the last one.
+// The buffers are persistently mapped, so the CPU evaluator can write into them directly.
+class HeightBuffer
+{
+public:
+	// Binding point of the Heights buffer in the shaders
+	static const unsigned int BINDING = 2;
+
+	// Make sure every buffer holds pointCount heights, only allocating if the count changed
+	void resize(unsigned int pointCount);
+	void destroy();
+
+	// Move on to the next buffer of the ring and bind it, returns its name.
+	// Only waits if the GPU is still reading that buffer.
+	unsigned int next();
+
+	// Get the buffer with the latest heights
+	unsigned int current() const;
+	// Bind the current buffer again, after something else was bound in its place
+	void bind() const;
+	// Get the mapped memory of the current buffer, for writing on the CPU
+	float* getMappedMemory() const;
+
+	// Mark the end of the draws that read the current buffer
+	void endFrame();
+
+	// Fence the calculation that was just recorded and send it to the GPU,
+	// so the CPU can carry on with input and the GUI while the heights are calculated
+	void submit();
+	// Whether the last submitted calculation is finished, never waits
+	bool isReady();
+
+	// Instrumentation: storage allocations in total, calculations since the last allocation,
+	// and how often the CPU had to wait for the GPU
+	unsigned int getAllocationCount() const;
+	unsigned int getWritesSinceAllocation() const;
+	unsigned int getWaitCount() const;
+
+private:
+	static const int BUFFER_COUNT = 3;
+
+	unsigned int buffers[BUFFER_COUNT] = { 0, 0, 0 };
+	float* mappedMemory[BUFFER_COUNT] = { nullptr, nullptr, nullptr };
+	GLsync fences[BUFFER_COUNT] = { 0, 0, 0 };
+	GLsync calculationFence = 0;
+	int currentBuffer = 0;
+	unsigned int pointCount = 0;
+
+	unsigned int allocationCount = 0;
+	unsigned int writesSinceAllocation = 0;
+	unsigned int waitCount = 0;
+};
@@ -0,0 +1,323 @@
+#include "HeightCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#include "Expression.h"
+
+// Append the bytes of a value to a key
+template<typename T>
+static void appendBytes(std::string& key, const T& value)
+{
+	key.append((const char*)&value, sizeof(value));
+}
+
+void HeightCache::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled)
+		clear();
+}
+
+bool HeightCache::isEnabled() const
+{
+	return enabled;
+}
+
+void HeightCache::setBudgets(size_t gpuBytes, size_t cpuBytes)
+{
+	gpuBudget = gpuBytes;
+	cpuBudget = cpuBytes;
+	trim();
+}
+
+size_t HeightCache::getGpuBudget() const
+{
+	return gpuBudget;
+}
+
+size_t HeightCache::getCpuBudget() const
+{
+	return cpuBudget;
+}
+
+void HeightCache::setFunction(const std::string& function)
+{
+	// The generated code is the same for functions that only differ in spacing
+	try
+	{
+		functionHash = std::hash<std::string>()(Expression(function).toGLSL());
+	}
+	catch (const ExpressionError&)
+	{
+		functionHash = std::hash<std::string>()(function);
+	}
+}
+
+std::string HeightCache::getKey(const std::vector<float>& variables, float scale, float graphWidth, float centerX, float centerZ, unsigned int size,
+	unsigned int backend) const
+{
+	std::string key;
+	key.reserve(sizeof(size_t) + 2 * sizeof(unsigned int) + 4 * sizeof(float) + variables.size() * sizeof(uint32_t));
+	appendBytes(key, functionHash);
+	appendBytes(key, size);
+	appendBytes(key, backend);
+	appendBytes(key, scale);
+	appendBytes(key, graphWidth);
+	appendBytes(key, centerX);
+	appendBytes(key, centerZ);
+
+	for (float variable : variables)
+	{
+		// Rounding away the lowest bits of the mantissa
+		uint32_t bits;
+		std::memcpy(&bits, &variable, sizeof(bits));
+		bits = (bits + (1u << (QUANTIZATION_BITS - 1))) & ~((1u << QUANTIZATION_BITS) - 1);
+		appendBytes(key, bits);
+	}
+	return key;
+}
+
+bool HeightCache::load(const std::string& key, HeightBuffer& heightBuffer)
+{
+	if (!enabled)
+		return false;
+
+	std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = index.find(key);
+	if (found == index.end())
+	{
+		misses++;
+		return false;
+	}
+
+	// Moving the entry to the front of the list keeps its iterator valid
+	std::list<Entry>::iterator entry = found->second;
+	entries.splice(entries.begin(), entries, entry);
+	finishSpills();
+
+	heightBuffer.next();
+	if (entry->buffer != 0)
+	{
+		// Copying on the GPU, buffer copies are ordered with the draws that read the heights
+		glCopyNamedBufferSubData(entry->buffer, heightBuffer.current(), 0, 0, entry->bytes);
+		gpuHits++;
+	}
+	else if (entry->staging != 0)
+	{
+		// Still being read back, the staging buffer has the heights as well
+		glCopyNamedBufferSubData(entry->staging, heightBuffer.current(), 0, 0, entry->bytes);
+		cpuHits++;
+	}
+	else
+	{
+		// Writing into the mapped buffer, and moving the entry back to the GPU as it is in use again
+		std::memcpy(heightBuffer.getMappedMemory(), entry->heights.data(), entry->bytes);
+		cpuBytes -= entry->bytes;
+		trim(entry->bytes);
+		entry->buffer = acquireBuffer(entry->bytes);
+		glNamedBufferSubData(entry->buffer, 0, entry->bytes, entry->heights.data());
+		entry->heights = std::vector<float>();
+		gpuBytes += entry->bytes;
+		cpuHits++;
+		trim();
+	}
+	heightBuffer.submit();
+	return true;
+}
+
+void HeightCache::store(const std::string& key, const HeightBuffer& heightBuffer, unsigned int pointCount)
+{
+	if (!enabled || index.count(key) != 0)
+		return;
+
+	size_t bytes = (size_t)pointCount * sizeof(float);
+	if (bytes > gpuBudget)
+		return;
+
+	// Making room first, so the buffer of an entry spilled for it can be reused
+	finishSpills();
+	trim(bytes);
+
+	Entry entry;
+	entry.key = key;
+	entry.bytes = bytes;
+	entry.buffer = acquireBuffer(bytes);
+	entry.staging = 0;
+	entry.fence = 0;
+
+	// The compute shader writes the heights as storage, which copies only see after a barrier
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(heightBuffer.current(), entry.buffer, 0, 0, bytes);
+
+	entries.push_front(entry);
+	index[key] = entries.begin();
+	gpuBytes += bytes;
+	trim();
+}
+
+void HeightCache::clear()
+{
+	while (!entries.empty())
+	{
+		remove(entries.begin());
+	}
+	for (const FreeBuffer& freeBuffer : freeBuffers)
+	{
+		glDeleteBuffers(1, &freeBuffer.buffer);
+	}
+	freeBuffers.clear();
+	freeBytes = 0;
+}
+
+unsigned int HeightCache::getGpuHitCount() const
+{
+	return gpuHits;
+}
+
+unsigned int HeightCache::getCpuHitCount() const
+{
+	return cpuHits;
+}
+
+unsigned int HeightCache::getMissCount() const
+{
+	return misses;
+}
+
+unsigned int HeightCache::getSpillCount() const
+{
+	return spills;
+}
+
+unsigned int HeightCache::getEvictionCount() const
+{
+	return evictions;
+}
+
+size_t HeightCache::getGpuBytes() const
+{
+	return gpuBytes;
+}
+
+size_t HeightCache::getCpuBytes() const
+{
+	return cpuBytes;
+}
+
+size_t HeightCache::getEntryCount() const
+{
+	return entries.size();
+}
+
+void HeightCache::trim(size_t reserve)
+{
+	// Spilling the least recently used GPU entries into CPU memory
+	for (std::list<Entry>::reverse_iterator entry = entries.rbegin(); gpuBytes + reserve > gpuBudget && entry != entries.rend(); ++entry)
+	{
+		if (entry->buffer == 0)
+			continue;
+
+		// Copying into a staging buffer in client memory, which is read once the fence shows the copy finished.
+		// Copies are ordered, so the buffer can be reused right away.
+		glCreateBuffers(1, &entry->staging);
+		glNamedBufferStorage(entry->staging, entry->bytes, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+		glCopyNamedBufferSubData(entry->buffer, entry->staging, 0, 0, entry->bytes);
+		entry->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		releaseBuffer(entry->buffer, entry->bytes);
+		entry->buffer = 0;
+		gpuBytes -= entry->bytes;
+		cpuBytes += entry->bytes;
+		spills++;
+	}
+
+	// Free buffers only stay while there is room for them
+	while (!freeBuffers.empty() && gpuBytes + freeBytes > gpuBudget)
+	{
+		glDeleteBuffers(1, &freeBuffers.front().buffer);
+		freeBytes -= freeBuffers.front().bytes;
+		freeBuffers.erase(freeBuffers.begin());
+	}
+
+	// Dropping the least recently used CPU entries
+	while (cpuBytes > cpuBudget)
+	{
+		std::list<Entry>::iterator entry = entries.end();
+		do
+		{
+			--entry;
+		} while (entry->buffer != 0);
+		remove(entry);
+		evictions++;
+	}
+}
+
+void HeightCache::finishSpills()
+{
+	for (Entry& entry : entries)
+	{
+		if (entry.fence == 0)
+			continue;
+
+		// Only checking, never waiting
+		GLenum status = glClientWaitSync(entry.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+
+		entry.heights.resize(entry.bytes / sizeof(float));
+		const void* mapped = glMapNamedBufferRange(entry.staging, 0, entry.bytes, GL_MAP_READ_BIT);
+		if (mapped != nullptr)
+			std::memcpy(entry.heights.data(), mapped, entry.bytes);
+		glUnmapNamedBuffer(entry.staging);
+		glDeleteBuffers(1, &entry.staging);
+		glDeleteSync(entry.fence);
+		entry.staging = 0;
+		entry.fence = 0;
+	}
+}
+
+void HeightCache::remove(std::list<Entry>::iterator entry)
+{
+	if (entry->buffer != 0)
+	{
+		glDeleteBuffers(1, &entry->buffer);
+		gpuBytes -= entry->bytes;
+	}
+	else
+	{
+		if (entry->staging != 0)
+		{
+			glDeleteBuffers(1, &entry->staging);
+			glDeleteSync(entry->fence);
+		}
+		cpuBytes -= entry->bytes;
+	}
+	index.erase(entry->key);
+	entries.erase(entry);
+}
+
+unsigned int HeightCache::acquireBuffer(size_t bytes)
+{
+	for (size_t i = 0; i < freeBuffers.size(); i++)
+	{
+		if (freeBuffers[i].bytes == bytes)
+		{
+			unsigned int buffer = freeBuffers[i].buffer;
+			freeBuffers.erase(freeBuffers.begin() + i);
+			freeBytes -= bytes;
+			return buffer;
+		}
+	}
+
+	// Dynamic storage, so heights coming back from the CPU can be uploaded into a reused buffer
+	unsigned int buffer = 0;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	return buffer;
+}
+
+void HeightCache::releaseBuffer(unsigned int buffer, size_t bytes)
+{
+	freeBuffers.push_back({ buffer, bytes });
+	freeBytes += bytes;
+}
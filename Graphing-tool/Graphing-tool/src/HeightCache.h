@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "HeightBuffer.h"
+
+// Least recently used cache of calculated heights, so returning to a function, variables and bounds
+// that were calculated before only copies the heights instead of calculating them again.
+// Entries are kept in GPU buffers until the GPU budget is full, then the least recently used ones
+// are read back into CPU memory, and dropped once the CPU budget is full as well.
+// Read backs go through a staging buffer and a fence, so spilling never waits for the GPU,
+// and the buffers of spilled entries are reused for new entries of the same size.
+class HeightCache
+{
+public:
+	// Low mantissa bits of the variables that are ignored, so values within float noise of each other share heights
+	static const unsigned int QUANTIZATION_BITS = 8;
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	// Memory budgets of both tiers in bytes, evicting entries beyond them
+	void setBudgets(size_t gpuBytes, size_t cpuBytes);
+	size_t getGpuBudget() const;
+	size_t getCpuBudget() const;
+
+	// Set the function the heights are calculated with, entries of other functions are kept
+	void setFunction(const std::string& function);
+
+	// Get the key of the heights of the current function for these variables and bounds.
+	// The backend tells the calculations apart, so switching to another one calculates the heights with it.
+	std::string getKey(const std::vector<float>& variables, float scale, float graphWidth, float centerX, float centerZ, unsigned int size,
+		unsigned int backend) const;
+
+	// Copy the cached heights of the key into the next buffer of the height buffer, returns false if there are none
+	bool load(const std::string& key, HeightBuffer& heightBuffer);
+	// Keep a copy of the heights just calculated into the current buffer of the height buffer
+	void store(const std::string& key, const HeightBuffer& heightBuffer, unsigned int pointCount);
+
+	void clear();
+
+	// Instrumentation
+	unsigned int getGpuHitCount() const;
+	unsigned int getCpuHitCount() const;
+	unsigned int getMissCount() const;
+	unsigned int getSpillCount() const;
+	unsigned int getEvictionCount() const;
+	size_t getGpuBytes() const;
+	size_t getCpuBytes() const;
+	size_t getEntryCount() const;
+
+private:
+	struct Entry
+	{
+		std::string key;
+		size_t bytes;
+		// The GPU copy, or 0 once spilled to the CPU
+		unsigned int buffer;
+		// While spilling: the buffer the heights are read back into, and the fence after the copy into it
+		unsigned int staging;
+		GLsync fence;
+		std::vector<float> heights;
+	};
+
+	// A GPU buffer that is not used by an entry, kept to be reused
+	struct FreeBuffer
+	{
+		unsigned int buffer;
+		size_t bytes;
+	};
+
+	bool enabled = true;
+	size_t gpuBudget = 256 * 1024 * 1024;
+	size_t cpuBudget = 512 * 1024 * 1024;
+	size_t functionHash = 0;
+
+	// Most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+	size_t gpuBytes = 0;
+	size_t cpuBytes = 0;
+	// Free buffers count towards the GPU budget as well
+	std::vector<FreeBuffer> freeBuffers;
+	size_t freeBytes = 0;
+
+	unsigned int gpuHits = 0;
+	unsigned int cpuHits = 0;
+	unsigned int misses = 0;
+	unsigned int spills = 0;
+	unsigned int evictions = 0;
+
+	// Spill and evict the least recently used entries until both tiers fit their budget,
+	// keeping room for reserve more bytes on the GPU
+	void trim(size_t reserve = 0);
+	// Copy the read back heights of spilling entries whose copy finished into CPU memory
+	void finishSpills();
+	void remove(std::list<Entry>::iterator entry);
+
+	// Get a buffer of the size, reusing a free one if possible
+	unsigned int acquireBuffer(size_t bytes);
+	void releaseBuffer(unsigned int buffer, size_t bytes);
+};
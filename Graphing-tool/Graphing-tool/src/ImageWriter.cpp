@@ -0,0 +1,38 @@
+#include "ImageWriter.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+bool writePPM(const std::string& path, int width, int height, const unsigned char* pixels)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write((const char*)pixels, (std::streamsize)width * height * 3);
+	return (bool)file;
+}
+
+bool writePFM(const std::string& path, int width, int height, const float* values)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	// A negative scale marks the data as little endian
+	uint16_t endianTest = 1;
+	unsigned char firstByte;
+	std::memcpy(&firstByte, &endianTest, 1);
+	file << "Pf\n" << width << " " << height << "\n" << (firstByte == 1 ? "-1.0" : "1.0") << "\n";
+	file.write((const char*)values, (std::streamsize)width * height * sizeof(float));
+	return (bool)file;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Writers for the simple file formats of the headless mode, which need no libraries
+
+// Write an 8 bit RGB image as binary PPM, rows from top to bottom.
+// Returns whether the file was written.
+bool writePPM(const std::string& path, int width, int height, const unsigned char* pixels);
+
+// Write a single channel float image as PFM, rows from bottom to top like the format expects.
+// Returns whether the file was written.
+bool writePFM(const std::string& path, int width, int height, const float* values);
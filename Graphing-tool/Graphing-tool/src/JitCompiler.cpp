@@ -0,0 +1,1108 @@
+#include "JitCompiler.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JIT_SUPPORTED 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+namespace
+{
+	// Instruction set extensions the compiled code can use
+	struct Features
+	{
+		bool avx2;
+		bool fma;
+	};
+
+	Features detectFeatures()
+	{
+		Features features = { false, false };
+#if JIT_SUPPORTED
+		unsigned int info[4] = {};
+#if defined(_MSC_VER)
+		__cpuidex((int*)info, 1, 0);
+#else
+		__cpuid_count(1, 0, info[0], info[1], info[2], info[3]);
+#endif
+		bool osxsave = (info[2] & (1u << 27)) != 0;
+		bool avx = (info[2] & (1u << 28)) != 0;
+		bool fma = (info[2] & (1u << 12)) != 0;
+		if (!osxsave || !avx)
+			return features;
+
+		// The operating system has to save the upper halves of the AVX registers
+#if defined(_MSC_VER)
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		unsigned long long xcr0 = ((unsigned long long)high << 32) | low;
+#endif
+		if ((xcr0 & 6) != 6)
+			return features;
+
+#if defined(_MSC_VER)
+		__cpuidex((int*)info, 7, 0);
+#else
+		__cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#endif
+		features.avx2 = (info[1] & (1u << 5)) != 0;
+		features.fma = features.avx2 && fma;
+#endif
+		return features;
+	}
+
+	const Features& getFeatures()
+	{
+		static const Features features = detectFeatures();
+		return features;
+	}
+
+	// General purpose register numbers as used in the instruction encoding
+	enum Register : uint8_t
+	{
+		RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+		R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+	};
+
+	// Registers the compiled code keeps its state in (all preserved across calls)
+	const Register X_POINTER = R12;
+	const Register OUT_POINTER = R13;
+	const Register COUNT = R14;
+	const Register INDEX = R15;
+	const Register LANES_POINTER = RBX;
+
+	// Registers the arguments are passed in
+#if defined(_WIN32)
+	const Register ARGUMENTS[4] = { RCX, RDX, R8, R9 };
+	// xmm6 to xmm15 are preserved across calls on Windows
+	const int32_t SAVED_VECTOR_BYTES = 10 * 16;
+#else
+	const Register ARGUMENTS[4] = { RDI, RSI, RDX, RCX };
+	const int32_t SAVED_VECTOR_BYTES = 0;
+#endif
+
+	// Vector registers: the x coordinates and the first registers of the program live in the homes,
+	// the inlined functions work in the temporaries, results of registers kept on the stack go through RESULT,
+	// and SCRATCH is only used inside the instruction helpers
+	const int HOME_COUNT = 7;
+	const int FIRST_TEMPORARY = 7;
+	const int RESULT = 14;
+	const int SCRATCH = 15;
+
+	// Bytes of an AVX register, the size of every stack slot and constant
+	const int32_t VECTOR_BYTES = 32;
+
+	// Opcodes after the 0F escape byte
+	enum Opcode : uint8_t
+	{
+		MOVUPS_LOAD = 0x10,
+		MOVUPS_STORE = 0x11,
+		SQRTPS = 0x51,
+		ANDPS = 0x54,
+		ANDNPS = 0x55,
+		ORPS = 0x56,
+		XORPS = 0x57,
+		ADDPS = 0x58,
+		MULPS = 0x59,
+		CVTDQ2PS = 0x5B,	// With an F3 prefix: CVTTPS2DQ
+		SUBPS = 0x5C,
+		MINPS = 0x5D,
+		DIVPS = 0x5E,
+		MAXPS = 0x5F,
+		SHIFT_IMMEDIATE = 0x72,
+		PCMPEQD = 0x76,
+		CMPPS = 0xC2,
+		PAND = 0xDB,
+		PANDN = 0xDF,
+		PSUBD = 0xFA,
+		PADDD = 0xFE
+	};
+
+	// Predicates of CMPPS
+	const int EQUAL = 0;
+	const int LESS = 1;
+	const int LESS_EQUAL = 2;
+	// The unordered and negated predicates are also true where either value is NaN
+	const int UNORDERED = 3;
+	const int NOT_LESS = 5;
+	const int NOT_LESS_EQUAL = 6;
+
+	// An operand of a vector instruction
+	struct Operand
+	{
+		enum class Type
+		{
+			Register,
+			Stack,		// [rsp + displacement]
+			Lane,		// [rbx + displacement]
+			Constant,	// [rip + displacement], an entry of the constant pool
+			X,			// [r12 + r15 * 4]
+			Out			// [r13 + r15 * 4]
+		};
+		Type type;
+		int32_t value;
+
+		bool isRegister(int r) const
+		{
+			return type == Type::Register && value == r;
+		}
+	};
+
+	Operand reg(int r)
+	{
+		return Operand{ Operand::Type::Register, r };
+	}
+
+	Operand temporary(int index)
+	{
+		return reg(FIRST_TEMPORARY + index);
+	}
+
+	// Writes x86-64 machine code into a byte buffer
+	class Assembler
+	{
+	public:
+		std::vector<uint8_t> code;
+		// Use VEX encoded AVX2 instructions on 256 bit registers instead of SSE2
+		bool avx = false;
+		bool fma = false;
+
+		void byte(uint8_t value)
+		{
+			code.push_back(value);
+		}
+
+		void int32(int32_t value)
+		{
+			for (int i = 0; i < 4; i++)
+				byte((uint8_t)(value >> (i * 8)));
+		}
+
+		void push(Register r)
+		{
+			if (r >= R8)
+				byte(0x41);
+			byte(0x50 + (r & 7));
+		}
+
+		void pop(Register r)
+		{
+			if (r >= R8)
+				byte(0x41);
+			byte(0x58 + (r & 7));
+		}
+
+		// destination = source (64 bit)
+		void move(Register destination, Register source)
+		{
+			byte(0x48 | (source >= R8 ? 0x04 : 0) | (destination >= R8 ? 0x01 : 0));
+			byte(0x89);
+			byte(0xC0 | ((source & 7) << 3) | (destination & 7));
+		}
+
+		// destination = 0
+		void clear(Register destination)
+		{
+			byte(0x48 | (destination >= R8 ? 0x05 : 0));
+			byte(0x31);
+			byte(0xC0 | ((destination & 7) << 3) | (destination & 7));
+		}
+
+		// rsp -= value
+		void subtractStack(int32_t value)
+		{
+			byte(0x48); byte(0x81); byte(0xEC);
+			int32(value);
+		}
+
+		// rsp &= value, to align the stack
+		void alignStack(int8_t value)
+		{
+			byte(0x48); byte(0x83); byte(0xE4);
+			byte((uint8_t)value);
+		}
+
+		// r += value
+		void addImmediate8(Register r, int8_t value)
+		{
+			byte(0x48 | (r >= R8 ? 0x01 : 0));
+			byte(0x83);
+			byte(0xC0 | (r & 7));
+			byte((uint8_t)value);
+		}
+
+		// Compare a with b (unsigned, 64 bit)
+		void compare(Register a, Register b)
+		{
+			byte(0x48 | (b >= R8 ? 0x04 : 0) | (a >= R8 ? 0x01 : 0));
+			byte(0x39);
+			byte(0xC0 | ((b & 7) << 3) | (a & 7));
+		}
+
+		// Jump if above or equal, returns the position of the offset to patch
+		size_t jumpAboveOrEqual()
+		{
+			byte(0x0F); byte(0x83);
+			int32(0);
+			return code.size() - 4;
+		}
+
+		void jump(size_t target)
+		{
+			byte(0xE9);
+			int32((int32_t)(target - (code.size() + 4)));
+		}
+
+		// Point a previously emitted jump to the current position
+		void patch(size_t offsetPosition)
+		{
+			int32_t offset = (int32_t)(code.size() - (offsetPosition + 4));
+			std::memcpy(&code[offsetPosition], &offset, 4);
+		}
+
+		void zeroUpper()
+		{
+			byte(0xC5); byte(0xF8); byte(0x77);
+		}
+
+		void ret()
+		{
+			byte(0xC3);
+		}
+
+		/* Constants */
+
+		// Get a constant with the bits repeated over every lane
+		Operand bits(uint32_t value)
+		{
+			for (size_t i = 0; i < constants.size(); i++)
+			{
+				if (constants[i] == value)
+					return Operand{ Operand::Type::Constant, (int32_t)i };
+			}
+			constants.push_back(value);
+			return Operand{ Operand::Type::Constant, (int32_t)constants.size() - 1 };
+		}
+
+		Operand number(float value)
+		{
+			uint32_t valueBits;
+			std::memcpy(&valueBits, &value, sizeof(valueBits));
+			return bits(valueBits);
+		}
+
+		// Append the constants after the code and point the instructions that read them at them
+		void finish()
+		{
+			while (code.size() % VECTOR_BYTES != 0)
+				byte(0xCC);
+			size_t pool = code.size();
+			for (uint32_t value : constants)
+			{
+				for (int i = 0; i < VECTOR_BYTES / 4; i++)
+					int32((int32_t)value);
+			}
+			for (const Fixup& fixup : fixups)
+			{
+				// Relative to the end of the instruction
+				int32_t offset = (int32_t)(pool + fixup.constant * VECTOR_BYTES - fixup.instructionEnd);
+				std::memcpy(&code[fixup.position], &offset, 4);
+			}
+		}
+
+		/* Vector instructions */
+
+		// Encodes an instruction on vector registers, with a VEX prefix for AVX or the legacy SSE encoding.
+		// prefix is 0, 0x66 or 0xF3, map is 1 for 0F, 2 for 0F38 and 3 for 0F3A.
+		// reg is the ModRM reg field, source the first source of VEX instructions, which SSE leaves out.
+		void vector(uint8_t prefix, uint8_t map, uint8_t opcode, int reg, int source, Operand rm, int immediate = -1, bool wide = true)
+		{
+			bool extendReg = reg >= 8;
+			bool extendIndex = rm.type == Operand::Type::X || rm.type == Operand::Type::Out;
+			bool extendBase = extendIndex || (rm.type == Operand::Type::Register && rm.value >= 8);
+
+			if (avx)
+			{
+				uint8_t pp = prefix == 0x66 ? 1 : prefix == 0xF3 ? 2 : 0;
+				byte(0xC4);
+				byte((extendReg ? 0 : 0x80) | (extendIndex ? 0 : 0x40) | (extendBase ? 0 : 0x20) | map);
+				byte((uint8_t)(((~source & 15) << 3) | (wide ? 0x04 : 0) | pp));
+			}
+			else
+			{
+				if (prefix != 0)
+					byte(prefix);
+				if (extendReg || extendIndex || extendBase)
+					byte(0x40 | (extendReg ? 0x04 : 0) | (extendIndex ? 0x02 : 0) | (extendBase ? 0x01 : 0));
+				byte(0x0F);
+				if (map == 2)
+					byte(0x38);
+				else if (map == 3)
+					byte(0x3A);
+			}
+			byte(opcode);
+
+			switch (rm.type)
+			{
+			case Operand::Type::Register:
+				byte((uint8_t)(0xC0 | ((reg & 7) << 3) | (rm.value & 7)));
+				break;
+			case Operand::Type::Stack:
+				// mod 10, rm 100 (SIB follows), SIB: no index, base rsp
+				byte((uint8_t)(0x84 | ((reg & 7) << 3)));
+				byte(0x24);
+				int32(rm.value);
+				break;
+			case Operand::Type::Lane:
+				// mod 10, rm = rbx
+				byte((uint8_t)(0x80 | ((reg & 7) << 3) | RBX));
+				int32(rm.value);
+				break;
+			case Operand::Type::Constant:
+				// mod 00, rm 101: relative to the end of the instruction
+				byte((uint8_t)(0x05 | ((reg & 7) << 3)));
+				fixups.push_back({ code.size(), (size_t)rm.value, code.size() + 4 + (immediate >= 0 ? 1 : 0) });
+				int32(0);
+				break;
+			case Operand::Type::X:
+			case Operand::Type::Out:
+				// mod 01 (8 bit displacement), rm 100 (SIB follows), SIB: scale 4, index r15, base r12 or r13
+				byte((uint8_t)(0x44 | ((reg & 7) << 3)));
+				byte((uint8_t)(0x80 | ((INDEX & 7) << 3) | ((rm.type == Operand::Type::X ? X_POINTER : OUT_POINTER) & 7)));
+				byte((uint8_t)(int8_t)rm.value);
+				break;
+			}
+
+			if (immediate >= 0)
+				byte((uint8_t)immediate);
+		}
+
+		// destination = source
+		void move(int destination, Operand source)
+		{
+			if (!source.isRegister(destination))
+				vector(0, 1, MOVUPS_LOAD, destination, 0, source);
+		}
+
+		void store(Operand destination, int source, bool wide = true)
+		{
+			vector(0, 1, MOVUPS_STORE, source, 0, destination, -1, wide);
+		}
+
+		// destination = a op b. SSE only has destructive two operand forms, which may need SCRATCH.
+		void binary(uint8_t prefix, uint8_t opcode, bool commutative, int destination, Operand a, Operand b, int immediate = -1)
+		{
+			if (avx)
+			{
+				// The first source of VEX instructions has to be a register
+				if (a.type != Operand::Type::Register)
+				{
+					move(SCRATCH, a);
+					a = reg(SCRATCH);
+				}
+				vector(prefix, 1, opcode, destination, a.value, b, immediate);
+				return;
+			}
+
+			if (!a.isRegister(destination))
+			{
+				if (b.isRegister(destination))
+				{
+					if (commutative)
+					{
+						vector(prefix, 1, opcode, destination, 0, a, immediate);
+						return;
+					}
+					move(SCRATCH, b);
+					b = reg(SCRATCH);
+				}
+				move(destination, a);
+			}
+			vector(prefix, 1, opcode, destination, 0, b, immediate);
+		}
+
+		void add(int destination, Operand a, Operand b) { binary(0, ADDPS, true, destination, a, b); }
+		void subtract(int destination, Operand a, Operand b) { binary(0, SUBPS, false, destination, a, b); }
+		void multiply(int destination, Operand a, Operand b) { binary(0, MULPS, true, destination, a, b); }
+		void divide(int destination, Operand a, Operand b) { binary(0, DIVPS, false, destination, a, b); }
+		// MINPS and MAXPS return the second operand if either is NaN, so they are not commutative
+		void minimum(int destination, Operand a, Operand b) { binary(0, MINPS, false, destination, a, b); }
+		void maximum(int destination, Operand a, Operand b) { binary(0, MAXPS, false, destination, a, b); }
+		void bitAnd(int destination, Operand a, Operand b) { binary(0, ANDPS, true, destination, a, b); }
+		// destination = ~a & b
+		void bitAndNot(int destination, Operand a, Operand b) { binary(0, ANDNPS, false, destination, a, b); }
+		void bitOr(int destination, Operand a, Operand b) { binary(0, ORPS, true, destination, a, b); }
+		void bitXor(int destination, Operand a, Operand b) { binary(0, XORPS, true, destination, a, b); }
+		void compare(int destination, Operand a, Operand b, int predicate) { binary(0, CMPPS, predicate == EQUAL, destination, a, b, predicate); }
+		void addInt(int destination, Operand a, Operand b) { binary(0x66, PADDD, true, destination, a, b); }
+		void subtractInt(int destination, Operand a, Operand b) { binary(0x66, PSUBD, false, destination, a, b); }
+		void andInt(int destination, Operand a, Operand b) { binary(0x66, PAND, true, destination, a, b); }
+		// destination = ~a & b
+		void andNotInt(int destination, Operand a, Operand b) { binary(0x66, PANDN, false, destination, a, b); }
+		void equalInt(int destination, Operand a, Operand b) { binary(0x66, PCMPEQD, true, destination, a, b); }
+
+		void squareRoot(int destination, Operand a) { vector(0, 1, SQRTPS, destination, 0, a); }
+		void toInt(int destination, Operand a) { vector(0xF3, 1, CVTDQ2PS, destination, 0, a); }
+		void toFloat(int destination, Operand a) { vector(0, 1, CVTDQ2PS, destination, 0, a); }
+
+		// Shift every 32 bit lane of a register left or right
+		void shiftLeft(int destination, int a, int bits) { shift(6, destination, a, bits); }
+		void shiftRight(int destination, int a, int bits) { shift(2, destination, a, bits); }
+
+		// destination = b where the mask is set and a elsewhere
+		void select(int destination, int mask, Operand a, Operand b)
+		{
+			if (avx)
+			{
+				if (a.type != Operand::Type::Register)
+				{
+					move(SCRATCH, a);
+					a = reg(SCRATCH);
+				}
+				// VBLENDVPS, the mask register goes in the upper bits of the immediate
+				vector(0x66, 3, 0x4A, destination, a.value, b, mask << 4);
+				return;
+			}
+			vector(0, 1, MOVUPS_LOAD, SCRATCH, 0, reg(mask));
+			vector(0, 1, ANDNPS, SCRATCH, 0, a);
+			bitAnd(destination, reg(mask), b);
+			vector(0, 1, ORPS, destination, 0, reg(SCRATCH));
+		}
+
+		// y = y * x + c, with x a register
+		void multiplyAdd(int y, int x, Operand c)
+		{
+			if (fma)
+			{
+				// VFMADD213PS
+				vector(0x66, 2, 0xA8, y, x, c);
+				return;
+			}
+			multiply(y, reg(y), reg(x));
+			add(y, reg(y), c);
+		}
+
+		// x = x + y * c, calculating the product in temporary without FMA
+		void addProduct(int x, int y, Operand c, int temporary)
+		{
+			if (fma)
+			{
+				// VFMADD231PS
+				vector(0x66, 2, 0xB8, x, y, c);
+				return;
+			}
+			multiply(temporary, reg(y), c);
+			add(x, reg(x), reg(temporary));
+		}
+
+		// x = x - y * c, calculating the product in temporary without FMA
+		void subtractProduct(int x, int y, Operand c, int temporary)
+		{
+			if (fma)
+			{
+				// VFNMADD231PS
+				vector(0x66, 2, 0xBC, x, y, c);
+				return;
+			}
+			multiply(temporary, reg(y), c);
+			subtract(x, reg(x), reg(temporary));
+		}
+
+		/* Inlined functions, the single precision Cephes approximations of SimdMath */
+
+		// Rounds down, SSE2 truncates and corrects values that were rounded up using two temporaries
+		void floor(int destination, Operand a, int truncated, int mask)
+		{
+			if (avx)
+			{
+				// VROUNDPS towards negative infinity, without precision exceptions
+				vector(0x66, 3, 0x08, destination, 0, a, 0x09);
+				return;
+			}
+			toInt(truncated, a);
+			toFloat(truncated, reg(truncated));
+			compare(mask, a, reg(truncated), LESS);
+			bitAnd(mask, reg(mask), number(1.0f));
+			subtract(truncated, reg(truncated), reg(mask));
+			// Keeping the sign of -0, which ceil relies on to turn 0 into 0 instead of -0
+			bitAnd(mask, a, bits(0x80000000));
+			bitOr(truncated, reg(truncated), reg(mask));
+			// Floats this large are already whole numbers (and would overflow the conversion), like infinity and NaN
+			bitAnd(mask, a, bits(0x7FFFFFFF));
+			compare(mask, reg(mask), number(8388608.0f), NOT_LESS);
+			select(destination, mask, reg(truncated), a);
+		}
+
+		// Sine, cosine or tangent, which share the range reduction. Uses temporaries 0 to 5.
+		void sinCos(int destination, Operand a, BytecodeProgram::Opcode function)
+		{
+			typedef BytecodeProgram::Opcode Function;
+			const int sign = FIRST_TEMPORARY, x = FIRST_TEMPORARY + 1, j = FIRST_TEMPORARY + 2;
+			const int y = FIRST_TEMPORARY + 3, t = FIRST_TEMPORARY + 4;
+
+			bitAnd(sign, a, bits(0x80000000));
+			bitAnd(x, a, bits(0x7FFFFFFF));
+
+			// Scaling by 4/pi and rounding to an even octant
+			multiply(j, reg(x), number(1.27323954473516f));
+			toInt(j, reg(j));
+			addInt(j, reg(j), bits(1));
+			andInt(j, reg(j), bits(~1u));
+			toFloat(y, reg(j));
+
+			// Extended precision modular arithmetic: x - y * pi/4
+			addProduct(x, y, number(-0.78515625f), t);
+			addProduct(x, y, number(-2.4187564849853515625e-4f), t);
+			addProduct(x, y, number(-3.77489497744594108e-8f), t);
+
+			// Sign of the sine
+			andInt(t, reg(j), bits(4));
+			shiftLeft(t, t, 29);
+			bitXor(sign, reg(sign), reg(t));
+
+			const int z = FIRST_TEMPORARY + 3, p1 = FIRST_TEMPORARY + 4, p2 = FIRST_TEMPORARY + 5;
+			multiply(z, reg(x), reg(x));
+
+			// Cosine polynomial on [-pi/4, pi/4]
+			move(p1, number(2.443315711809948e-5f));
+			multiplyAdd(p1, z, number(-1.388731625493765e-3f));
+			multiplyAdd(p1, z, number(4.166664568298827e-2f));
+			multiply(p1, reg(p1), reg(z));
+			multiply(p1, reg(p1), reg(z));
+			// Subtracting z / 2 on its own, so infinity gives NaN like SimdMath instead of infinity
+			subtractProduct(p1, z, number(0.5f), FIRST_TEMPORARY + 5);
+			add(p1, reg(p1), number(1.0f));
+
+			// Sine polynomial on [-pi/4, pi/4]
+			move(p2, number(-1.9515295891e-4f));
+			multiplyAdd(p2, z, number(8.3321608736e-3f));
+			multiplyAdd(p2, z, number(-1.6666654611e-1f));
+			multiply(p2, reg(p2), reg(z));
+			multiplyAdd(p2, x, reg(x));
+
+			// Octants that use the second polynomial for the sine
+			const int usePolynomialTwo = x;
+			andInt(usePolynomialTwo, reg(j), bits(2));
+			equalInt(usePolynomialTwo, reg(usePolynomialTwo), bits(0));
+
+			const int sine = function == Function::Tan ? z : destination;
+			if (function != Function::Cos)
+			{
+				select(sine, usePolynomialTwo, reg(p1), reg(p2));
+				bitXor(sine, reg(sine), reg(sign));
+			}
+
+			const int cosine = function == Function::Tan ? j : destination;
+			if (function != Function::Sin)
+			{
+				const int cosineSign = sign;
+				subtractInt(cosineSign, reg(j), bits(2));
+				andNotInt(cosineSign, reg(cosineSign), bits(4));
+				shiftLeft(cosineSign, cosineSign, 29);
+				select(cosine, usePolynomialTwo, reg(p2), reg(p1));
+				bitXor(cosine, reg(cosine), reg(cosineSign));
+			}
+
+			if (function == Function::Tan)
+				divide(destination, reg(sine), reg(cosine));
+		}
+
+		// Uses temporaries 0 to 5, a may be one of 0 to 3
+		void exp(int destination, Operand a)
+		{
+			const int x = FIRST_TEMPORARY, n = FIRST_TEMPORARY + 1;
+			const int overflow = FIRST_TEMPORARY + 4, invalid = FIRST_TEMPORARY + 5;
+			// The clamp only keeps the range reduction valid, the edges are set at the end
+			compare(overflow, number(88.7228393554688f), a, LESS);
+			compare(invalid, a, a, UNORDERED);
+			// Below log(FLT_MIN) 2^(n - 1) is 0, which flushes the results to 0 like denormals
+			minimum(x, a, number(88.7228393554688f));
+			maximum(x, reg(x), number(-87.3365478515625f));
+
+			// exp(x) = 2^n * exp(g), with n = round(x / log(2))
+			move(n, number(1.44269504088896341f));
+			multiplyAdd(n, x, number(0.5f));
+			floor(n, reg(n), FIRST_TEMPORARY + 2, FIRST_TEMPORARY + 3);
+			subtractProduct(x, n, number(0.693359375f), FIRST_TEMPORARY + 2);
+			subtractProduct(x, n, number(-2.12194440e-4f), FIRST_TEMPORARY + 2);
+
+			const int z = FIRST_TEMPORARY + 2, y = FIRST_TEMPORARY + 3;
+			multiply(z, reg(x), reg(x));
+			move(y, number(1.9875691500e-4f));
+			multiplyAdd(y, x, number(1.3981999507e-3f));
+			multiplyAdd(y, x, number(8.3334519073e-3f));
+			multiplyAdd(y, x, number(4.1665795894e-2f));
+			multiplyAdd(y, x, number(1.6666665459e-1f));
+			multiplyAdd(y, x, number(5.0000001201e-1f));
+			multiplyAdd(y, z, reg(x));
+			add(y, reg(y), number(1.0f));
+
+			// Building 2^(n - 1) directly in the exponent bits, as 2^128 has none
+			toInt(n, reg(n));
+			addInt(n, reg(n), bits(0x7E));
+			shiftLeft(n, n, 23);
+			multiply(y, reg(y), reg(n));
+			add(y, reg(y), reg(y));
+
+			// exp(x) is infinity above log(FLT_MAX), and NaN of NaN
+			select(y, overflow, reg(y), number(std::numeric_limits<float>::infinity()));
+			bitOr(destination, reg(y), reg(invalid));
+		}
+
+		// Uses temporaries 0 to 5
+		void log(int destination, Operand a)
+		{
+			const int invalid = FIRST_TEMPORARY, edge = FIRST_TEMPORARY + 1, x = FIRST_TEMPORARY + 2;
+			const int e = FIRST_TEMPORARY + 3, small = FIRST_TEMPORARY + 4, t = FIRST_TEMPORARY + 5;
+			// Negative numbers and NaN
+			compare(invalid, bits(0), a, NOT_LESS_EQUAL);
+			compare(edge, a, bits(0), EQUAL);
+			compare(t, a, number(std::numeric_limits<float>::infinity()), EQUAL);
+			bitOr(edge, reg(edge), reg(t));
+
+			// Splitting into exponent and a mantissa in [0.5, 1)
+			maximum(x, a, bits(0x00800000));
+			shiftRight(e, x, 23);
+			subtractInt(e, reg(e), bits(0x7F));
+			toFloat(e, reg(e));
+			add(e, reg(e), number(1.0f));
+			bitAnd(x, reg(x), bits(~0x7F800000u));
+			bitOr(x, reg(x), number(0.5f));
+
+			// Moving the mantissa to [sqrt(1/2), sqrt(2))
+			compare(small, reg(x), number(0.707106781186547524f), LESS);
+			bitAnd(t, reg(x), reg(small));
+			subtract(x, reg(x), number(1.0f));
+			bitAnd(small, reg(small), number(1.0f));
+			subtract(e, reg(e), reg(small));
+			add(x, reg(x), reg(t));
+
+			const int z = FIRST_TEMPORARY + 4, y = FIRST_TEMPORARY + 5;
+			multiply(z, reg(x), reg(x));
+			move(y, number(7.0376836292e-2f));
+			multiplyAdd(y, x, number(-1.1514610310e-1f));
+			multiplyAdd(y, x, number(1.1676998740e-1f));
+			multiplyAdd(y, x, number(-1.2420140846e-1f));
+			multiplyAdd(y, x, number(1.4249322787e-1f));
+			multiplyAdd(y, x, number(-1.6668057665e-1f));
+			multiplyAdd(y, x, number(2.0000714765e-1f));
+			multiplyAdd(y, x, number(-2.4999993993e-1f));
+			multiplyAdd(y, x, number(3.3333331174e-1f));
+			multiply(y, reg(y), reg(x));
+			multiply(y, reg(y), reg(z));
+
+			// Subtracting z / 2 first frees z for the products with the exponent
+			multiply(z, reg(z), number(0.5f));
+			subtract(y, reg(y), reg(z));
+			addProduct(y, e, number(-2.12194440e-4f), z);
+			add(x, reg(x), reg(y));
+			addProduct(x, e, number(0.693359375f), z);
+
+			// log(0) = -infinity and log(infinity) = infinity, which have the sign of the exponent.
+			// The log of a negative number or NaN is NaN.
+			multiply(z, reg(e), number(std::numeric_limits<float>::infinity()));
+			select(x, edge, reg(x), reg(z));
+			bitOr(destination, reg(x), reg(invalid));
+		}
+
+		// Uses temporaries 0 to 6
+		void pow(int destination, Operand a, Operand b)
+		{
+			// a^b = e^(b log(a)), with a^0 = 1 as in the C library
+			const int result = FIRST_TEMPORARY + 6;
+			log(result, a);
+			multiply(result, reg(result), b);
+			exp(result, reg(result));
+			compare(FIRST_TEMPORARY, b, bits(0), EQUAL);
+			select(destination, FIRST_TEMPORARY, reg(result), number(1.0f));
+		}
+
+		// Uses temporaries 0 to 6
+		void atan(int destination, Operand a)
+		{
+			const int sign = FIRST_TEMPORARY, x = FIRST_TEMPORARY + 1, large = FIRST_TEMPORARY + 2, medium = FIRST_TEMPORARY + 3;
+			const int offset = FIRST_TEMPORARY + 4, t1 = FIRST_TEMPORARY + 5, t2 = FIRST_TEMPORARY + 6;
+			bitAnd(sign, a, bits(0x80000000));
+			bitAnd(x, a, bits(0x7FFFFFFF));
+
+			// Range reduction to [0, tan(pi/8)]
+			compare(large, number(2.414213562373095f), reg(x), LESS);
+			compare(medium, number(0.4142135623730950f), reg(x), LESS);
+			bitAndNot(medium, reg(large), reg(medium));
+			select(offset, medium, bits(0), number(0.785398163397448f));
+			select(offset, large, reg(offset), number(1.570796326794897f));
+			subtract(t1, reg(x), number(1.0f));
+			add(t2, reg(x), number(1.0f));
+			divide(t1, reg(t1), reg(t2));
+			select(t1, medium, reg(x), reg(t1));
+			divide(t2, number(-1.0f), reg(x));
+			select(x, large, reg(t1), reg(t2));
+
+			const int z = large, y = medium;
+			multiply(z, reg(x), reg(x));
+			move(y, number(8.05374449538e-2f));
+			multiplyAdd(y, z, number(-1.38776856032e-1f));
+			multiplyAdd(y, z, number(1.99777106478e-1f));
+			multiplyAdd(y, z, number(-3.33329491539e-1f));
+			multiply(y, reg(y), reg(z));
+			multiplyAdd(y, x, reg(x));
+
+			add(destination, reg(y), reg(offset));
+			bitXor(destination, reg(destination), reg(sign));
+		}
+
+		// Arcsine, or arccosine as pi/2 - asin. Uses temporaries 0 to 5.
+		void asin(int destination, Operand a, bool acos)
+		{
+			const int sign = FIRST_TEMPORARY, absolute = FIRST_TEMPORARY + 1, invalid = FIRST_TEMPORARY + 2;
+			const int large = FIRST_TEMPORARY + 3, z = FIRST_TEMPORARY + 4, r = FIRST_TEMPORARY + 5;
+			bitAnd(sign, a, bits(0x80000000));
+			bitAnd(absolute, a, bits(0x7FFFFFFF));
+			compare(invalid, number(1.0f), reg(absolute), LESS);
+
+			// Near 1 using asin(a) = pi/2 - 2 asin(sqrt((1 - a) / 2))
+			compare(large, number(0.5f), reg(absolute), LESS);
+			subtract(r, number(1.0f), reg(absolute));
+			multiply(r, reg(r), number(0.5f));
+			multiply(z, reg(absolute), reg(absolute));
+			select(z, large, reg(z), reg(r));
+			squareRoot(r, reg(z));
+			select(r, large, reg(absolute), reg(r));
+
+			const int y = absolute;
+			move(y, number(4.2163199048e-2f));
+			multiplyAdd(y, z, number(2.4181311049e-2f));
+			multiplyAdd(y, z, number(4.5470025998e-2f));
+			multiplyAdd(y, z, number(7.4953002686e-2f));
+			multiplyAdd(y, z, number(1.6666752422e-1f));
+			multiply(y, reg(y), reg(z));
+			multiplyAdd(y, r, reg(r));
+
+			add(z, reg(y), reg(y));
+			subtract(z, number(1.570796326794897f), reg(z));
+			select(y, large, reg(y), reg(z));
+			bitXor(y, reg(y), reg(sign));
+			if (acos)
+			{
+				bitOr(y, reg(y), reg(invalid));
+				subtract(destination, number(1.570796326794897f), reg(y));
+			}
+			else
+			{
+				bitOr(destination, reg(y), reg(invalid));
+			}
+		}
+
+	private:
+		// An instruction reading a constant, patched once the position of the constants is known
+		struct Fixup
+		{
+			size_t position;
+			size_t constant;
+			size_t instructionEnd;
+		};
+
+		std::vector<uint32_t> constants;
+		std::vector<Fixup> fixups;
+
+		void shift(int extension, int destination, int a, int bits)
+		{
+			if (avx)
+			{
+				// The destination is the first source of VEX shifts
+				vector(0x66, 1, SHIFT_IMMEDIATE, extension, destination, reg(a), bits);
+				return;
+			}
+			move(destination, reg(a));
+			vector(0x66, 1, SHIFT_IMMEDIATE, extension, 0, reg(destination), bits);
+		}
+	};
+}
+
+JitFunction::JitFunction(const BytecodeProgram& program)
+{
+#if JIT_SUPPORTED
+	typedef BytecodeProgram::Opcode Opcode;
+
+	Assembler assembler;
+	assembler.avx = getFeatures().avx2;
+	assembler.fma = getFeatures().fma;
+	width = assembler.avx ? 8 : 4;
+	laneCount = program.getScalarCount();
+
+	// The x coordinates live in the first home, registers of the program that do not fit in the homes go on the stack
+	unsigned int registerCount = program.getRegisterCount();
+	unsigned int stackRegisters = registerCount > HOME_COUNT - 1 ? registerCount - (HOME_COUNT - 1) : 0;
+	int32_t stackBytes = stackRegisters * VECTOR_BYTES;
+	int32_t frameSize = (stackBytes + SAVED_VECTOR_BYTES + VECTOR_BYTES - 1) / VECTOR_BYTES * VECTOR_BYTES;
+
+	auto home = [](uint8_t index)
+	{
+		if (index == BytecodeProgram::X_REGISTER)
+			return reg(0);
+		if (index < HOME_COUNT - 1)
+			return reg(index + 1);
+		return Operand{ Operand::Type::Stack, (index - (HOME_COUNT - 1)) * VECTOR_BYTES };
+	};
+	auto lane = [](unsigned int index) { return Operand{ Operand::Type::Lane, (int32_t)(sizeof(Lane) * index) }; };
+
+	/* Prologue: saving the registers the compiled code uses, and aligning the stack for the stack slots */
+	assembler.push(RBX);
+	assembler.push(RBP);
+	assembler.push(R12);
+	assembler.push(R13);
+	assembler.push(R14);
+	assembler.push(R15);
+	assembler.move(RBP, RSP);
+	assembler.alignStack(-VECTOR_BYTES);
+	assembler.subtractStack(frameSize);
+	for (int i = 0; i < SAVED_VECTOR_BYTES / 16; i++)
+		assembler.store(Operand{ Operand::Type::Stack, stackBytes + 16 * i }, 6 + i, false);
+
+	assembler.move(X_POINTER, ARGUMENTS[0]);
+	assembler.move(OUT_POINTER, ARGUMENTS[1]);
+	assembler.move(COUNT, ARGUMENTS[2]);
+	assembler.move(LANES_POINTER, ARGUMENTS[3]);
+	assembler.clear(INDEX);
+
+	/* Loop over the points, a vector at a time */
+	size_t loopStart = assembler.code.size();
+	assembler.compare(INDEX, COUNT);
+	size_t exitJump = assembler.jumpAboveOrEqual();
+
+	// Programs that do not depend on x only write
+	bool readsX = false;
+	for (const BytecodeProgram::Instruction& instruction : program.getInstructions())
+	{
+		bool hasRegisterB = instruction.opcode == Opcode::Add || instruction.opcode == Opcode::Subtract || instruction.opcode == Opcode::Multiply
+			|| instruction.opcode == Opcode::Divide || instruction.opcode == Opcode::Min || instruction.opcode == Opcode::Max || instruction.opcode == Opcode::Pow;
+		if ((instruction.opcode != Opcode::LoadScalar && instruction.a == BytecodeProgram::X_REGISTER)
+			|| (hasRegisterB && instruction.b == BytecodeProgram::X_REGISTER))
+			readsX = true;
+	}
+	if (readsX)
+		assembler.move(0, Operand{ Operand::Type::X, 0 });
+
+	for (const BytecodeProgram::Instruction& instruction : program.getInstructions())
+	{
+		Operand a = home(instruction.a);
+		Operand destinationHome = home(instruction.destination);
+		int destination = destinationHome.type == Operand::Type::Register ? destinationHome.value : RESULT;
+
+		switch (instruction.opcode)
+		{
+		case Opcode::LoadScalar: assembler.move(destination, lane(instruction.b)); break;
+		case Opcode::Copy: assembler.move(destination, a); break;
+		case Opcode::Negate: assembler.bitXor(destination, a, assembler.bits(0x80000000)); break;
+		case Opcode::Abs: assembler.bitAnd(destination, a, assembler.bits(0x7FFFFFFF)); break;
+		case Opcode::Add: assembler.add(destination, a, home(instruction.b)); break;
+		case Opcode::Subtract: assembler.subtract(destination, a, home(instruction.b)); break;
+		case Opcode::Multiply: assembler.multiply(destination, a, home(instruction.b)); break;
+		case Opcode::Divide: assembler.divide(destination, a, home(instruction.b)); break;
+		case Opcode::Min: assembler.minimum(destination, a, home(instruction.b)); break;
+		case Opcode::Max: assembler.maximum(destination, a, home(instruction.b)); break;
+		case Opcode::AddScalar: assembler.add(destination, a, lane(instruction.b)); break;
+		case Opcode::SubtractScalar: assembler.subtract(destination, a, lane(instruction.b)); break;
+		case Opcode::ScalarSubtract: assembler.subtract(destination, lane(instruction.b), a); break;
+		case Opcode::MultiplyScalar: assembler.multiply(destination, a, lane(instruction.b)); break;
+		case Opcode::DivideScalar: assembler.divide(destination, a, lane(instruction.b)); break;
+		case Opcode::ScalarDivide: assembler.divide(destination, lane(instruction.b), a); break;
+		case Opcode::Sin: case Opcode::Cos: case Opcode::Tan: assembler.sinCos(destination, a, instruction.opcode); break;
+		case Opcode::Asin: assembler.asin(destination, a, false); break;
+		case Opcode::Acos: assembler.asin(destination, a, true); break;
+		case Opcode::Atan: assembler.atan(destination, a); break;
+		case Opcode::Exp: assembler.exp(destination, a); break;
+		case Opcode::Pow: assembler.pow(destination, a, home(instruction.b)); break;
+		case Opcode::Sqrt: assembler.squareRoot(destination, a); break;
+		case Opcode::Floor: assembler.floor(destination, a, FIRST_TEMPORARY, FIRST_TEMPORARY + 1); break;
+		case Opcode::Ceil:
+			// ceil(a) = -floor(-a)
+			assembler.bitXor(FIRST_TEMPORARY + 2, a, assembler.bits(0x80000000));
+			assembler.floor(destination, temporary(2), FIRST_TEMPORARY, FIRST_TEMPORARY + 1);
+			assembler.bitXor(destination, reg(destination), assembler.bits(0x80000000));
+			break;
+		}
+
+		if (destination == RESULT)
+			assembler.store(destinationHome, RESULT);
+	}
+
+	// Register 0 holds the result, which is divided by the divisor after the scalars
+	assembler.divide(RESULT, home(0), lane((unsigned int)laneCount));
+	assembler.store(Operand{ Operand::Type::Out, 0 }, RESULT);
+
+	assembler.addImmediate8(INDEX, (int8_t)width);
+	assembler.jump(loopStart);
+	assembler.patch(exitJump);
+
+	/* Epilogue */
+	if (assembler.avx)
+		assembler.zeroUpper();
+	for (int i = 0; i < SAVED_VECTOR_BYTES / 16; i++)
+		assembler.vector(0, 1, MOVUPS_LOAD, 6 + i, 0, Operand{ Operand::Type::Stack, stackBytes + 16 * i }, -1, false);
+	assembler.move(RSP, RBP);
+	assembler.pop(R15);
+	assembler.pop(R14);
+	assembler.pop(R13);
+	assembler.pop(R12);
+	assembler.pop(RBP);
+	assembler.pop(RBX);
+	assembler.ret();
+
+	codeSize = assembler.code.size();
+	assembler.finish();
+
+	/* Copying the code and its constants into executable memory */
+	memorySize = assembler.code.size();
+
+#if defined(_WIN32)
+	memory = VirtualAlloc(nullptr, memorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (memory == nullptr)
+		throw std::runtime_error("Could not allocate memory for compiled code");
+	std::memcpy(memory, assembler.code.data(), memorySize);
+	DWORD oldProtection;
+	if (!VirtualProtect(memory, memorySize, PAGE_EXECUTE_READ, &oldProtection))
+	{
+		VirtualFree(memory, 0, MEM_RELEASE);
+		throw std::runtime_error("Could not make compiled code executable");
+	}
+	FlushInstructionCache(GetCurrentProcess(), memory, memorySize);
+#else
+	memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+	{
+		memory = nullptr;
+		throw std::runtime_error("Could not allocate memory for compiled code");
+	}
+	std::memcpy(memory, assembler.code.data(), memorySize);
+	if (mprotect(memory, memorySize, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(memory, memorySize);
+		throw std::runtime_error("Could not make compiled code executable");
+	}
+#endif
+
+	kernel = (Kernel)memory;
+#else
+	(void)program;
+	throw std::runtime_error("Native code generation is only supported on x86-64");
+#endif
+}
+
+JitFunction::~JitFunction()
+{
+	if (memory == nullptr)
+		return;
+
+#if defined(_WIN32)
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, memorySize);
+#endif
+}
+
+bool JitFunction::isSupported()
+{
+	return JIT_SUPPORTED;
+}
+
+const char* JitFunction::getInstructionSet()
+{
+	if (getFeatures().fma)
+		return "AVX2 + FMA";
+	return getFeatures().avx2 ? "AVX2" : "SSE2";
+}
+
+void JitFunction::broadcastScalars(const std::vector<float>& scalars, float divisor, std::vector<Lane>& lanes) const
+{
+	lanes.resize(laneCount + 1);
+	for (size_t i = 0; i < scalars.size() && i < laneCount; i++)
+	{
+		for (int j = 0; j < 8; j++)
+			lanes[i].values[j] = scalars[i];
+	}
+	for (int j = 0; j < 8; j++)
+		lanes[laneCount].values[j] = divisor;
+}
+
+void JitFunction::execute(const float* x, float* out, size_t count, const Lane* lanes) const
+{
+	// The compiled loop handles whole vectors
+	size_t vectorCount = count - count % width;
+	kernel(x, out, vectorCount, lanes);
+
+	// The remaining points go through a padded copy
+	if (vectorCount < count)
+	{
+		alignas(32) float paddedX[8] = {};
+		alignas(32) float paddedOut[8];
+		std::memcpy(paddedX, x + vectorCount, (count - vectorCount) * sizeof(float));
+		kernel(paddedX, paddedOut, width, lanes);
+		std::memcpy(out + vectorCount, paddedOut, (count - vectorCount) * sizeof(float));
+	}
+}
+
+size_t JitFunction::getCodeSize() const
+{
+	return codeSize;
+}
+
+std::shared_ptr<JitFunction> JitCompiler::compile(const BytecodeProgram& program, const std::string& source)
+{
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].first == source)
+		{
+			hits++;
+			std::shared_ptr<JitFunction> function = entries[i].second;
+			entries.erase(entries.begin() + i);
+			entries.insert(entries.begin(), std::make_pair(source, function));
+			return function;
+		}
+	}
+
+	misses++;
+	std::shared_ptr<JitFunction> function = std::make_shared<JitFunction>(program);
+	entries.insert(entries.begin(), std::make_pair(source, function));
+	if (entries.size() > MAX_ENTRIES)
+	{
+		// The evaluator keeps its own reference, so a function in use stays alive
+		entries.pop_back();
+		evictions++;
+	}
+	return function;
+}
+
+unsigned int JitCompiler::getHitCount() const
+{
+	return hits;
+}
+
+unsigned int JitCompiler::getMissCount() const
+{
+	return misses;
+}
+
+unsigned int JitCompiler::getEvictionCount() const
+{
+	return evictions;
+}
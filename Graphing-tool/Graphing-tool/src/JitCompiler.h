@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BytecodeProgram.h"
+
+// A bytecode program compiled to native x86-64 code.
+// The compiled loop calculates one vector of points per iteration, with AVX2 (and FMA) when the processor
+// supports it and SSE2 otherwise. The registers of the program stay in vector registers where they fit,
+// and every function is inlined, using the same polynomial approximations as SimdMath.
+class JitFunction
+{
+public:
+	// A scalar repeated over the eight lanes of an AVX register, SSE code only reads the first four
+	struct Lane
+	{
+		alignas(16) float values[8];
+	};
+
+	// Compiles the program, throws a std::runtime_error if native code can not be generated
+	JitFunction(const BytecodeProgram& program);
+	~JitFunction();
+
+	// Whether native code can be generated on this platform
+	static bool isSupported();
+	// Get the name of the instruction set the compiled code uses on this processor
+	static const char* getInstructionSet();
+
+	// Broadcast the scalars of a prepared workspace into the layout the compiled code reads,
+	// followed by the divisor every result is divided by
+	void broadcastScalars(const std::vector<float>& scalars, float divisor, std::vector<Lane>& lanes) const;
+
+	// Calculate the function divided by the divisor for count points with the given x coordinates.
+	// The z coordinate is read from the broadcast scalars like every other scalar.
+	void execute(const float* x, float* out, size_t count, const Lane* lanes) const;
+
+	// Get the number of bytes of machine code
+	size_t getCodeSize() const;
+
+private:
+	typedef void (*Kernel)(const float* x, float* out, size_t count, const Lane* lanes);
+
+	Kernel kernel = nullptr;
+	void* memory = nullptr;
+	size_t memorySize = 0;
+	size_t codeSize = 0;
+
+	// Points calculated per iteration of the compiled loop
+	size_t width = 4;
+	size_t laneCount = 0;
+
+	JitFunction(const JitFunction&) = delete;
+	JitFunction& operator=(const JitFunction&) = delete;
+};
+
+// Keeps compiled functions by the GLSL generated for them, so switching back to a function
+// or recalculating after changing a variable never compiles again.
+// The least recently used functions are dropped once there are more than MAX_ENTRIES.
+class JitCompiler
+{
+public:
+	static const size_t MAX_ENTRIES = 16;
+
+	// Get the compiled program for the source, compiling it if it is not cached yet
+	std::shared_ptr<JitFunction> compile(const BytecodeProgram& program, const std::string& source);
+
+	unsigned int getHitCount() const;
+	unsigned int getMissCount() const;
+	unsigned int getEvictionCount() const;
+
+private:
+	// Most recently used first
+	std::vector<std::pair<std::string, std::shared_ptr<JitFunction>>> entries;
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int evictions = 0;
+};
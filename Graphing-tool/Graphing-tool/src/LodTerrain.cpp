@@ -0,0 +1,292 @@
+#include "LodTerrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+static_assert(LodTerrain::MAX_CHUNKS <= LodTerrain::CHUNK_SLOTS, "Every chunk of an update needs a slot of the atlas");
+
+void LodTerrain::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled)
+		clear();
+}
+
+bool LodTerrain::isEnabled() const
+{
+	return enabled;
+}
+
+void LodTerrain::setFunction(const std::string& function)
+{
+	if (shader)
+		glDeleteProgram(shader->ID);
+	shader.reset();
+	this->function = function;
+	clear();
+}
+
+void LodTerrain::setMaxLevel(int level)
+{
+	maxLevel = std::min(std::max(level, 0), MAX_LEVEL);
+}
+
+int LodTerrain::getMaxLevel() const
+{
+	return maxLevel;
+}
+
+void LodTerrain::setDetailDistance(float distance)
+{
+	detailDistance = std::max(distance, 0.0f);
+}
+
+float LodTerrain::getDetailDistance() const
+{
+	return detailDistance;
+}
+
+void LodTerrain::update(glm::vec3 cameraPosition, const std::vector<float>& variables, float scale, float graphWidth, glm::vec2 center, glm::uvec2 workgroupSize)
+{
+	// Other settings make every chunk out of date
+	std::vector<float> settings(variables);
+	settings.insert(settings.end(), { scale, graphWidth, center.x, center.y });
+	chunks.validate(settings);
+
+	if (VAO == 0)
+	{
+		// Two triangles per cell, the same for every chunk
+		std::vector<unsigned int> indices;
+		indices.reserve((CHUNK_SAMPLES - 1) * (CHUNK_SAMPLES - 1) * 6);
+		for (int z = 0; z < CHUNK_SAMPLES - 1; z++)
+		{
+			for (int x = 0; x < CHUNK_SAMPLES - 1; x++)
+			{
+				unsigned int i = z * CHUNK_SAMPLES + x;
+				indices.insert(indices.end(), { i, i + CHUNK_SAMPLES + 1, i + 1, i, i + CHUNK_SAMPLES, i + CHUNK_SAMPLES + 1 });
+			}
+		}
+		glCreateVertexArrays(1, &VAO);
+		glCreateBuffers(1, &EBO);
+		glNamedBufferStorage(EBO, indices.size() * sizeof(unsigned int), indices.data(), 0);
+		glVertexArrayElementBuffer(VAO, EBO);
+
+		glCreateBuffers(1, &heightBuffer);
+		glNamedBufferStorage(heightBuffer, (size_t)CHUNK_SLOTS * CHUNK_SAMPLES * CHUNK_SAMPLES * sizeof(float), nullptr, 0);
+		glCreateBuffers(1, &recordBuffer);
+		glCreateBuffers(1, &chunkBuffer);
+	}
+
+	// Balancing splits more chunks, so the selection is repeated with a smaller budget until every chunk has a slot
+	std::unordered_set<ChunkKey, ChunkKeyHash> leaves;
+	size_t budget = MAX_CHUNKS;
+	while (true)
+	{
+		leaves.clear();
+		select(cameraPosition, graphWidth, budget, leaves);
+		balance(leaves);
+		if (leaves.size() <= (size_t)MAX_CHUNKS)
+			break;
+		budget = budget * MAX_CHUNKS / leaves.size();
+	}
+
+	// Finding the chunks in the atlas, and the chunks to calculate
+	chunks.beginUse();
+	std::vector<ChunkInstance> instances;
+	std::vector<ChunkKey> missing;
+	for (const ChunkKey& key : leaves)
+	{
+		ChunkInstance instance;
+		instance.spacing = 2.0f / (float)((CHUNK_SAMPLES - 1) << key.level);
+		instance.originX = -1.0f + (float)(key.x * (CHUNK_SAMPLES - 1)) * instance.spacing;
+		instance.originZ = -1.0f + (float)(key.z * (CHUNK_SAMPLES - 1)) * instance.spacing;
+		instance.slot = -1;
+		instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+
+		// Sides bordering a coarser chunk, which is one level coarser after balancing
+		instance.coarserSides = 0;
+		const ChunkKey neighbours[4] = { { key.x - 1, key.z, key.level }, { key.x + 1, key.z, key.level },
+			{ key.x, key.z - 1, key.level }, { key.x, key.z + 1, key.level } };
+		for (int side = 0; side < 4; side++)
+		{
+			if (coveringLevel(neighbours[side], leaves) == key.level - 1)
+				instance.coarserSides |= 1 << side;
+		}
+
+		instance.slot = chunks.use(key);
+		if (instance.slot < 0)
+			missing.push_back(key);
+		instances.push_back(instance);
+	}
+
+	// Keeping the chunks of the last update if the new ones do not fit
+	if (!chunks.freeSlotsFor(missing.size()))
+		return;
+
+	std::vector<ChunkRecord> records;
+	size_t next = 0;
+	for (ChunkInstance& instance : instances)
+	{
+		if (instance.slot >= 0)
+			continue;
+		instance.slot = chunks.insert(missing[next++]);
+		records.push_back({ instance.originX, instance.originZ, instance.spacing, instance.slot });
+	}
+
+	// Calculating every new chunk at once, one chunk per layer of the dispatch
+	calculatedChunks = (unsigned int)records.size();
+	totalCalculatedChunks += calculatedChunks;
+	if (!records.empty())
+	{
+		if (!shader)
+			shader.reset(new ComputeShader(function, "src/shaders/calculatorChunkShader.shader", true, workgroupSize));
+
+		glNamedBufferData(recordBuffer, records.size() * sizeof(ChunkRecord), records.data(), GL_STREAM_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RECORD_BINDING, recordBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HEIGHT_BINDING, heightBuffer);
+
+		shader->use();
+		shader->setFloat(Uniform::Scale, scale);
+		shader->setFloat(Uniform::GraphWidth, graphWidth);
+		shader->setVector2(Uniform::Center, center);
+		shader->dispatch(CHUNK_SAMPLES, CHUNK_SAMPLES, (unsigned int)records.size());
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	glNamedBufferData(chunkBuffer, instances.size() * sizeof(ChunkInstance), instances.data(), GL_STREAM_DRAW);
+	chunkCount = (unsigned int)instances.size();
+}
+
+void LodTerrain::draw()
+{
+	if (chunkCount == 0)
+		return;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HEIGHT_BINDING, heightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHUNK_BINDING, chunkBuffer);
+	glBindVertexArray(VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, (CHUNK_SAMPLES - 1) * (CHUNK_SAMPLES - 1) * 6, GL_UNSIGNED_INT, 0, chunkCount);
+}
+
+void LodTerrain::clear()
+{
+	chunks.clear();
+	chunkCount = 0;
+}
+
+void LodTerrain::destroy()
+{
+	if (shader)
+		glDeleteProgram(shader->ID);
+	shader.reset();
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &heightBuffer);
+	glDeleteBuffers(1, &recordBuffer);
+	glDeleteBuffers(1, &chunkBuffer);
+	VAO = 0;
+	EBO = 0;
+	heightBuffer = 0;
+	recordBuffer = 0;
+	chunkBuffer = 0;
+	clear();
+}
+
+unsigned int LodTerrain::getChunkCount() const
+{
+	return chunkCount;
+}
+
+unsigned int LodTerrain::getVertexCount() const
+{
+	return chunkCount * CHUNK_SAMPLES * CHUNK_SAMPLES;
+}
+
+unsigned int LodTerrain::getCalculatedChunks() const
+{
+	return calculatedChunks;
+}
+
+unsigned int LodTerrain::getTotalCalculatedChunks() const
+{
+	return totalCalculatedChunks;
+}
+
+void LodTerrain::select(glm::vec3 cameraPosition, float graphWidth, size_t budget, std::unordered_set<ChunkKey, ChunkKeyHash>& leaves) const
+{
+	// Splitting level by level, so the chunk budget runs out far from the camera instead of in one corner
+	std::deque<ChunkKey> queue;
+	queue.push_back({ 0, 0, 0 });
+	size_t count = 1;
+	while (!queue.empty())
+	{
+		ChunkKey key = queue.front();
+		queue.pop_front();
+
+		// Distance from the camera to the chunk in world space, the heights are left out
+		float width = 2.0f * graphWidth / (float)(1 << key.level);
+		glm::vec2 minimum(-graphWidth + key.x * width, -graphWidth + key.z * width);
+		glm::vec2 camera(cameraPosition.x, cameraPosition.z);
+		glm::vec2 offset = glm::max(glm::max(minimum - camera, camera - minimum - width), glm::vec2(0.0f));
+		float distance = std::sqrt(glm::dot(offset, offset) + cameraPosition.y * cameraPosition.y);
+
+		if (key.level < maxLevel && distance < detailDistance * width && count + 3 <= budget)
+		{
+			for (int child = 0; child < 4; child++)
+				queue.push_back({ key.x * 2 + child % 2, key.z * 2 + child / 2, key.level + 1 });
+			count += 3;
+		}
+		else
+		{
+			leaves.insert(key);
+		}
+	}
+}
+
+void LodTerrain::balance(std::unordered_set<ChunkKey, ChunkKeyHash>& leaves)
+{
+	bool split = true;
+	while (split)
+	{
+		split = false;
+		std::vector<ChunkKey> keys(leaves.begin(), leaves.end());
+		for (const ChunkKey& key : keys)
+		{
+			if (leaves.count(key) == 0)
+				continue;
+
+			const ChunkKey neighbours[4] = { { key.x - 1, key.z, key.level }, { key.x + 1, key.z, key.level },
+				{ key.x, key.z - 1, key.level }, { key.x, key.z + 1, key.level } };
+			for (const ChunkKey& neighbour : neighbours)
+			{
+				int level = coveringLevel(neighbour, leaves);
+				if (level < 0 || level >= key.level - 1)
+					continue;
+
+				// Splitting the covering chunk, its children may need splitting in the next pass
+				int shift = neighbour.level - level;
+				ChunkKey covering = { neighbour.x >> shift, neighbour.z >> shift, level };
+				leaves.erase(covering);
+				for (int child = 0; child < 4; child++)
+					leaves.insert({ covering.x * 2 + child % 2, covering.z * 2 + child / 2, level + 1 });
+				split = true;
+			}
+		}
+	}
+}
+
+int LodTerrain::coveringLevel(const ChunkKey& key, const std::unordered_set<ChunkKey, ChunkKeyHash>& leaves)
+{
+	int count = 1 << key.level;
+	if (key.x < 0 || key.z < 0 || key.x >= count || key.z >= count)
+		return -1;
+
+	for (int level = key.level; level >= 0; level--)
+	{
+		int shift = key.level - level;
+		if (leaves.count({ key.x >> shift, key.z >> shift, level }) != 0)
+			return level;
+	}
+	return -1;
+}
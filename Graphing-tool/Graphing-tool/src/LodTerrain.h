@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ComputeShader.h"
+#include "SlotAtlas.h"
+
+// Draws the graph as a quadtree of chunks around the camera instead of a uniform grid.
+// Chunks close to the camera are split into four finer chunks, down to the finest level,
+// so the number of vertices depends on the view instead of on the size of the domain.
+// Neighbouring chunks differ by one level at most, and the finer chunk snaps its side to the coarser one.
+// The heights of every chunk are calculated once into an atlas and kept while the chunk stays in use.
+class LodTerrain
+{
+public:
+	// Samples along each side of a chunk
+	static const int CHUNK_SAMPLES = 65;
+	// Chunks the atlas holds, beyond the chunks of the current view the least recently used ones are replaced
+	static const int CHUNK_SLOTS = 2048;
+	// Chunks drawn at most, chunks are not split any further beyond it, including the splits that keep neighbours within one level.
+	// Every chunk of an update needs a slot, so it can not be more than CHUNK_SLOTS.
+	static const int MAX_CHUNKS = 1024;
+	// Finest level the quadtree can reach, 64 * 2^8 = 16384 cells along each side of the graph
+	static const int MAX_LEVEL = 8;
+	// Binding points of the ChunkHeights, ChunkRecords and Chunks buffers
+	static const unsigned int HEIGHT_BINDING = 8;
+	static const unsigned int RECORD_BINDING = 9;
+	static const unsigned int CHUNK_BINDING = 10;
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	// Set the function the heights are calculated with, which drops every chunk
+	void setFunction(const std::string& function);
+
+	// Finest level of the quadtree, from 0 (a single chunk) to MAX_LEVEL
+	void setMaxLevel(int level);
+	int getMaxLevel() const;
+	// A chunk is split while the camera is closer than this many times its width
+	void setDetailDistance(float distance);
+	float getDetailDistance() const;
+
+	// Pick the chunks for this camera position and calculate the heights of the new ones.
+	// The function reads the variables from the Variables buffer, the chunks are dropped when the values or the bounds change.
+	void update(glm::vec3 cameraPosition, const std::vector<float>& variables, float scale, float graphWidth, glm::vec2 center, glm::uvec2 workgroupSize);
+	// Draw the chunks picked by the last update, with a shader that reads them like lodVertexShader
+	void draw();
+
+	void clear();
+	void destroy();
+
+	// Instrumentation: chunks and vertices of the last update, and the chunks calculated so far
+	unsigned int getChunkCount() const;
+	unsigned int getVertexCount() const;
+	unsigned int getCalculatedChunks() const;
+	unsigned int getTotalCalculatedChunks() const;
+
+private:
+	// Chunk x and z counted from the corner of the graph at -1, -1, with 2^level chunks along each side
+	typedef SlotAtlas::Key ChunkKey;
+	typedef SlotAtlas::KeyHash ChunkKeyHash;
+
+	// Layout of the ChunkRecord struct of the chunk shader
+	struct ChunkRecord
+	{
+		float originX;
+		float originZ;
+		float spacing;
+		int slot;
+	};
+
+	// Layout of the Chunk struct of the vertex shader
+	struct ChunkInstance
+	{
+		float originX;
+		float originZ;
+		float spacing;
+		int slot;
+		int coarserSides;
+		int padding[3];
+	};
+
+	bool enabled = false;
+	std::string function;
+	int maxLevel = 6;
+	float detailDistance = 2.0f;
+
+	SlotAtlas chunks = SlotAtlas(CHUNK_SLOTS);
+
+	// Compiled on the first update of a function
+	std::unique_ptr<ComputeShader> shader;
+
+	unsigned int VAO = 0;
+	unsigned int EBO = 0;
+	unsigned int heightBuffer = 0;
+	unsigned int recordBuffer = 0;
+	unsigned int chunkBuffer = 0;
+
+	unsigned int chunkCount = 0;
+	unsigned int calculatedChunks = 0;
+	unsigned int totalCalculatedChunks = 0;
+
+	// Split chunks from the whole graph down while the camera is close to them, coarse levels first, into at most budget chunks
+	void select(glm::vec3 cameraPosition, float graphWidth, size_t budget, std::unordered_set<ChunkKey, ChunkKeyHash>& leaves) const;
+	// Split chunks until no chunk borders a chunk more than one level finer
+	void balance(std::unordered_set<ChunkKey, ChunkKeyHash>& leaves);
+	// Get the level of the chunk covering a key, or -1 if it is covered by finer chunks or outside the graph
+	static int coveringLevel(const ChunkKey& key, const std::unordered_set<ChunkKey, ChunkKeyHash>& leaves);
+};
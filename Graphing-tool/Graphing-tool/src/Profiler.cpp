@@ -0,0 +1,232 @@
+#include "Profiler.h"
+
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "imgui/imgui.h"
+
+void Profiler::create()
+{
+	if (enabled)
+		return;
+
+	startTime = std::chrono::steady_clock::now();
+
+	// Lining up the GPU clock with the CPU clock once, drift over a session is far below a frame
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	gpuOffset = now() - (double)gpuTime / 1000000.0;
+
+	enabled = true;
+}
+
+void Profiler::destroy()
+{
+	for (Frame& frame : frames)
+	{
+		if (!frame.queries.empty())
+			glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+		frame.queries.clear();
+		frame.events.clear();
+		frame.usedQueries = 0;
+	}
+	enabled = false;
+}
+
+bool Profiler::isEnabled() const
+{
+	return enabled;
+}
+
+void Profiler::beginFrame()
+{
+	if (!enabled)
+		return;
+
+	// The queries of this frame were recorded FRAME_COUNT frames ago, so their results should be in
+	currentFrame = (currentFrame + 1) % FRAME_COUNT;
+	collect(frames[currentFrame]);
+
+	cpuStack.clear();
+	gpuStack.clear();
+	beginCpu("Frame");
+}
+
+void Profiler::endFrame()
+{
+	if (!enabled)
+		return;
+
+	endCpu();
+}
+
+void Profiler::beginCpu(const char* name)
+{
+	if (!enabled)
+		return;
+
+	Frame& frame = frames[currentFrame];
+	Event event = { findPass(name, false), now(), 0.0, { 0, 0 } };
+	cpuStack.push_back(frame.events.size());
+	frame.events.push_back(event);
+}
+
+void Profiler::endCpu()
+{
+	if (!enabled || cpuStack.empty())
+		return;
+
+	frames[currentFrame].events[cpuStack.back()].end = now();
+	cpuStack.pop_back();
+}
+
+void Profiler::beginGpu(const char* name)
+{
+	if (!enabled)
+		return;
+
+	Frame& frame = frames[currentFrame];
+	Event event = { findPass(name, true), 0.0, 0.0, { queryTimestamp(), 0 } };
+	// Until the end is recorded the event has no duration
+	event.queries[1] = event.queries[0];
+	gpuStack.push_back(frame.events.size());
+	frame.events.push_back(event);
+}
+
+void Profiler::endGpu()
+{
+	if (!enabled || gpuStack.empty())
+		return;
+
+	frames[currentFrame].events[gpuStack.back()].queries[1] = queryTimestamp();
+	gpuStack.pop_back();
+}
+
+void Profiler::drawGui()
+{
+	if (!enabled)
+	{
+		ImGui::Text("Profiler not available");
+		return;
+	}
+
+	for (const Pass& pass : passes)
+	{
+		// The newest value is right before the history index
+		float latest = pass.history[(historyIndex + HISTORY_SIZE - 1) % HISTORY_SIZE];
+		char overlay[32];
+		snprintf(overlay, sizeof(overlay), "%.3f ms", latest);
+
+		std::string label = (pass.gpu ? "GPU " : "CPU ") + pass.name;
+		ImGui::PlotLines(label.c_str(), pass.history, HISTORY_SIZE, historyIndex, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+	}
+
+	if (ImGui::Button("Write Chrome trace"))
+	{
+		traceMessage = writeTrace("trace.json") ? "Written to trace.json" : "Could not write trace.json";
+	}
+	if (!traceMessage.empty())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", traceMessage.c_str());
+	}
+}
+
+bool Profiler::writeTrace(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	// Complete events ("X") with times in microseconds, the CPU and GPU on separate rows
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	for (const Event& event : trace)
+	{
+		const Pass& pass = passes[event.pass];
+		file << ",\n{\"name\":\"" << pass.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (pass.gpu ? 2 : 1)
+			<< ",\"ts\":" << (long long)(event.start * 1000.0)
+			<< ",\"dur\":" << (long long)((event.end - event.start) * 1000.0) << "}";
+	}
+	file << "\n]}\n";
+
+	return (bool)file;
+}
+
+int Profiler::findPass(const char* name, bool gpu)
+{
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		if (passes[i].gpu == gpu && passes[i].name == name)
+			return (int)i;
+	}
+
+	Pass pass;
+	pass.name = name;
+	pass.gpu = gpu;
+	std::memset(pass.history, 0, sizeof(pass.history));
+	passes.push_back(pass);
+	return (int)passes.size() - 1;
+}
+
+double Profiler::now() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+size_t Profiler::queryTimestamp()
+{
+	// The query pool of a frame only grows, so after the first frames no queries are created
+	Frame& frame = frames[currentFrame];
+	if (frame.usedQueries == frame.queries.size())
+	{
+		unsigned int query = 0;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+
+	glQueryCounter(frame.queries[frame.usedQueries], GL_TIMESTAMP);
+	return frame.usedQueries++;
+}
+
+void Profiler::collect(Frame& frame)
+{
+	if (frame.events.empty())
+		return;
+
+	std::vector<float> totals(passes.size(), 0.0f);
+	for (Event& event : frame.events)
+	{
+		if (passes[event.pass].gpu)
+		{
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(frame.queries[event.queries[0]], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.queries[event.queries[1]], GL_QUERY_RESULT, &end);
+			event.start = (double)begin / 1000000.0 + gpuOffset;
+			event.end = (double)end / 1000000.0 + gpuOffset;
+		}
+		// An event that was never ended has no duration
+		if (event.end < event.start)
+			event.end = event.start;
+
+		totals[event.pass] += (float)(event.end - event.start);
+		trace.push_back(event);
+	}
+
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		passes[i].history[historyIndex] = totals[i];
+	}
+	historyIndex = (historyIndex + 1) % HISTORY_SIZE;
+
+	while (trace.size() > MAX_TRACE_EVENTS)
+	{
+		trace.pop_front();
+	}
+
+	frame.events.clear();
+	frame.usedQueries = 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Measures named passes of every frame, on the CPU with a steady clock and on the GPU with timestamp queries.
+// GPU results are read a few frames later from a ring of query sets, so reading them never stalls the pipeline.
+// Keeps a rolling history per pass for the GUI, and the events of the last frames for a Chrome trace.
+class Profiler
+{
+public:
+	// Number of frames in the rolling history of every pass
+	static const int HISTORY_SIZE = 120;
+
+	// Create the GPU timer, scopes are ignored until this is called
+	void create();
+	void destroy();
+	bool isEnabled() const;
+
+	// Mark the start and end of a frame, the whole frame is measured as a CPU pass
+	void beginFrame();
+	void endFrame();
+
+	// Measure the CPU time between begin and end, scopes can be nested
+	void beginCpu(const char* name);
+	void endCpu();
+	// Measure the GPU time of the commands between begin and end, scopes can be nested
+	void beginGpu(const char* name);
+	void endGpu();
+
+	// Draw a rolling graph of every pass and a button to write the trace
+	void drawGui();
+
+	// Write the events of the last frames as Chrome trace JSON (chrome://tracing or Perfetto),
+	// returns whether the file could be written
+	bool writeTrace(const std::string& path) const;
+
+private:
+	// Number of frames the GPU results are read after their frame ended
+	static const int FRAME_COUNT = 4;
+	// Events kept for the trace, about a few seconds of frames
+	static const size_t MAX_TRACE_EVENTS = 20000;
+
+	struct Pass
+	{
+		std::string name;
+		bool gpu;
+		// Total milliseconds of the pass in every frame of the history
+		float history[HISTORY_SIZE];
+	};
+
+	struct Event
+	{
+		int pass;
+		// Milliseconds since the profiler was created, GPU times are moved onto the same timeline
+		double start;
+		double end;
+		// Indices into the queries of the frame, for GPU events
+		size_t queries[2];
+	};
+
+	struct Frame
+	{
+		std::vector<Event> events;
+		std::vector<unsigned int> queries;
+		size_t usedQueries = 0;
+	};
+
+	bool enabled = false;
+	std::chrono::steady_clock::time_point startTime;
+	// Milliseconds to add to a GPU timestamp to get the CPU time at that moment
+	double gpuOffset = 0.0;
+
+	std::vector<Pass> passes;
+	Frame frames[FRAME_COUNT];
+	int currentFrame = 0;
+	int historyIndex = 0;
+
+	// Open events of the current frame
+	std::vector<size_t> cpuStack;
+	std::vector<size_t> gpuStack;
+
+	std::deque<Event> trace;
+	std::string traceMessage;
+
+	// Get the index of the pass, adding it if it does not exist yet
+	int findPass(const char* name, bool gpu);
+	// Milliseconds since the profiler was created
+	double now() const;
+	// Record a timestamp query in the current frame, returns its index
+	size_t queryTimestamp();
+	// Read the results of a frame into the history and the trace, and clear it for reuse
+	void collect(Frame& frame);
+};
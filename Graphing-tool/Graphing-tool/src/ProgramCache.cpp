@@ -0,0 +1,202 @@
+#include "ProgramCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Mixes a hash into a seed, like boost::hash_combine
+static void combineHash(size_t& seed, size_t hash)
+{
+	seed ^= hash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+ProgramCache& ProgramCache::getInstance()
+{
+	static ProgramCache instance;
+	return instance;
+}
+
+bool ProgramCache::isEnabled()
+{
+	if (enabled == -1)
+	{
+		int formatCount = 0;
+		if (GLAD_GL_VERSION_4_1)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		enabled = formatCount > 0 ? 1 : 0;
+
+		// A binary from another driver (or driver version) can not be loaded, so the driver is part of every key
+		std::hash<std::string> hash;
+		driverHash = 0;
+		const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (GLenum name : names)
+		{
+			const char* value = (const char*)glGetString(name);
+			combineHash(driverHash, hash(value != NULL ? value : ""));
+		}
+
+		if (enabled)
+		{
+#if defined(_WIN32)
+			_mkdir(directory.c_str());
+#else
+			mkdir(directory.c_str(), 0755);
+#endif
+		}
+	}
+	return enabled == 1;
+}
+
+std::string ProgramCache::getKey(const std::string& functionCode, const std::string& templateCode)
+{
+	isEnabled();
+
+	std::hash<std::string> hash;
+	size_t key = driverHash;
+	combineHash(key, hash(functionCode));
+	combineHash(key, hash(templateCode));
+
+	char text[32];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long)key);
+	return std::string(text);
+}
+
+bool ProgramCache::load(const std::string& key, unsigned int program)
+{
+	if (!isEnabled())
+		return false;
+
+	loadIndex();
+	std::ifstream file(getPath(key), std::ios::binary);
+	if (!file || std::find(keys.begin(), keys.end(), key) == keys.end())
+	{
+		misses++;
+		return false;
+	}
+
+	// The binary format, followed by the binary itself
+	GLenum format = 0;
+	file.read((char*)&format, sizeof(format));
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+
+	int success = 0;
+	if (!binary.empty())
+	{
+		glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+	}
+	if (!success)
+	{
+		// The driver may reject binaries of an older version of itself
+		remove(key);
+		saveIndex();
+		misses++;
+		return false;
+	}
+
+	touch(key);
+	saveIndex();
+	hits++;
+	return true;
+}
+
+void ProgramCache::store(const std::string& key, unsigned int program)
+{
+	if (!isEnabled())
+		return;
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+	std::ofstream file(getPath(key), std::ios::binary);
+	file.write((const char*)&format, sizeof(format));
+	file.write(binary.data(), binary.size());
+	if (!file)
+	{
+		std::cout << "Error: could not write the program binary " << getPath(key) << std::endl;
+		return;
+	}
+	file.close();
+
+	loadIndex();
+	touch(key);
+	saveIndex();
+}
+
+unsigned int ProgramCache::getHitCount() const
+{
+	return hits;
+}
+
+unsigned int ProgramCache::getMissCount() const
+{
+	return misses;
+}
+
+unsigned int ProgramCache::getEvictionCount() const
+{
+	return evictions;
+}
+
+std::string ProgramCache::getPath(const std::string& key) const
+{
+	return directory + "/" + key + ".bin";
+}
+
+void ProgramCache::loadIndex()
+{
+	if (indexLoaded)
+		return;
+	indexLoaded = true;
+
+	std::ifstream file(directory + "/index.txt");
+	std::string key;
+	while (std::getline(file, key))
+	{
+		if (!key.empty())
+			keys.push_back(key);
+	}
+}
+
+void ProgramCache::saveIndex() const
+{
+	std::ofstream file(directory + "/index.txt");
+	for (const std::string& key : keys)
+	{
+		file << key << "\n";
+	}
+}
+
+void ProgramCache::touch(const std::string& key)
+{
+	keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+	keys.insert(keys.begin(), key);
+
+	while (keys.size() > MAX_ENTRIES)
+	{
+		remove(keys.back());
+		evictions++;
+	}
+}
+
+void ProgramCache::remove(const std::string& key)
+{
+	std::remove(getPath(key).c_str());
+	keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Keeps linked program binaries on disk, so a function that was compiled before loads without compiling.
+// Binaries are keyed by the generated GLSL of the function, the shader template and the driver,
+// as a binary only works on the driver that created it.
+// The least recently used binaries are removed once there are more than MAX_ENTRIES.
+class ProgramCache
+{
+public:
+	static const size_t MAX_ENTRIES = 64;
+
+	static ProgramCache& getInstance();
+
+	// Whether the driver supports program binaries, needs a current context
+	bool isEnabled();
+
+	// Get the key of a program from the GLSL of the function and the shader template it goes into
+	std::string getKey(const std::string& functionCode, const std::string& templateCode);
+
+	// Load the binary with the key into the program, returns false if there is none or the driver rejects it
+	bool load(const std::string& key, unsigned int program);
+	// Store the binary of a linked program, which should have GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	void store(const std::string& key, unsigned int program);
+
+	unsigned int getHitCount() const;
+	unsigned int getMissCount() const;
+	unsigned int getEvictionCount() const;
+
+private:
+	std::string directory = "shader_cache";
+
+	// -1 until checked
+	int enabled = -1;
+	// Hash of the vendor, renderer and version strings
+	size_t driverHash = 0;
+
+	// Keys from most to least recently used, read from the index file on first use
+	std::vector<std::string> keys;
+	bool indexLoaded = false;
+
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int evictions = 0;
+
+	ProgramCache() {}
+	ProgramCache(ProgramCache const&);
+	void operator=(ProgramCache const&);
+
+	std::string getPath(const std::string& key) const;
+	void loadIndex();
+	void saveIndex() const;
+	// Move the key to the front of the index, removing the least recently used entries beyond MAX_ENTRIES
+	void touch(const std::string& key);
+	void remove(const std::string& key);
+};
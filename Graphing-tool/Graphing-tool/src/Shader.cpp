@@ -31,7 +31,7 @@ Shader::Shader(std::string &function, const char* vertexPath, const char* fragme
 {
 	std::string vertexCode = readFile(vertexPath);
 	std::string fragmentCode = readFile(fragmentPath);
-	std::cout << replace(vertexCode, "$function", function);
+	std::cout << replace(vertexCode, "$function", functionToGLSL(function, throwError));
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
 
@@ -0,0 +1,476 @@
+#include "SimdMath.h"
+
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+// The polynomial approximations below are the single precision Cephes ones,
+// which are accurate to a few ulp over the ranges a graph is drawn in.
+
+namespace simd
+{
+	/* Thin wrappers around the intrinsics, so every function is written once for both instruction sets */
+
+#if defined(__AVX2__)
+	typedef __m256 Vec;
+	typedef __m256i VecInt;
+	const unsigned int WIDTH = 8;
+
+	inline Vec load(const float* p) { return _mm256_loadu_ps(p); }
+	inline void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+	inline Vec set(float f) { return _mm256_set1_ps(f); }
+	inline Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+	inline Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+	inline Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+	inline Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+	inline Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+	inline Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+	inline Vec sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+	inline Vec bitAnd(Vec a, Vec b) { return _mm256_and_ps(a, b); }
+	inline Vec bitAndNot(Vec a, Vec b) { return _mm256_andnot_ps(a, b); }
+	inline Vec bitOr(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+	inline Vec bitXor(Vec a, Vec b) { return _mm256_xor_ps(a, b); }
+	inline Vec lessThan(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline Vec lessEqual(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline Vec equal(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	// The negated and unordered compares are also set where either value is NaN
+	inline Vec notLessThan(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_NLT_UQ); }
+	inline Vec notLessEqual(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_NLE_UQ); }
+	inline Vec unordered(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_UNORD_Q); }
+	// Pick b where the mask is set and a elsewhere
+	inline Vec select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(a, b, mask); }
+	inline Vec floor(Vec a) { return _mm256_floor_ps(a); }
+
+	inline VecInt setInt(int i) { return _mm256_set1_epi32(i); }
+	inline VecInt toInt(Vec a) { return _mm256_cvttps_epi32(a); }
+	inline Vec toFloat(VecInt a) { return _mm256_cvtepi32_ps(a); }
+	inline VecInt addInt(VecInt a, VecInt b) { return _mm256_add_epi32(a, b); }
+	inline VecInt subInt(VecInt a, VecInt b) { return _mm256_sub_epi32(a, b); }
+	inline VecInt andInt(VecInt a, VecInt b) { return _mm256_and_si256(a, b); }
+	inline VecInt andNotInt(VecInt a, VecInt b) { return _mm256_andnot_si256(a, b); }
+	inline VecInt equalInt(VecInt a, VecInt b) { return _mm256_cmpeq_epi32(a, b); }
+	template <int bits> inline VecInt shiftLeft(VecInt a) { return _mm256_slli_epi32(a, bits); }
+	template <int bits> inline VecInt shiftRight(VecInt a) { return _mm256_srli_epi32(a, bits); }
+	inline Vec asFloat(VecInt a) { return _mm256_castsi256_ps(a); }
+	inline VecInt asInt(Vec a) { return _mm256_castps_si256(a); }
+#else
+	typedef __m128 Vec;
+	typedef __m128i VecInt;
+	const unsigned int WIDTH = 4;
+
+	inline Vec load(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+	inline Vec set(float f) { return _mm_set1_ps(f); }
+	inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+	inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+	inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+	inline Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+	inline Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+	inline Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+	inline Vec sqrt(Vec a) { return _mm_sqrt_ps(a); }
+	inline Vec bitAnd(Vec a, Vec b) { return _mm_and_ps(a, b); }
+	inline Vec bitAndNot(Vec a, Vec b) { return _mm_andnot_ps(a, b); }
+	inline Vec bitOr(Vec a, Vec b) { return _mm_or_ps(a, b); }
+	inline Vec bitXor(Vec a, Vec b) { return _mm_xor_ps(a, b); }
+	inline Vec lessThan(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+	inline Vec lessEqual(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+	inline Vec equal(Vec a, Vec b) { return _mm_cmpeq_ps(a, b); }
+	// The negated and unordered compares are also set where either value is NaN
+	inline Vec notLessThan(Vec a, Vec b) { return _mm_cmpnlt_ps(a, b); }
+	inline Vec notLessEqual(Vec a, Vec b) { return _mm_cmpnle_ps(a, b); }
+	inline Vec unordered(Vec a, Vec b) { return _mm_cmpunord_ps(a, b); }
+	// Pick b where the mask is set and a elsewhere
+	inline Vec select(Vec mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a)); }
+
+	inline VecInt setInt(int i) { return _mm_set1_epi32(i); }
+	inline VecInt toInt(Vec a) { return _mm_cvttps_epi32(a); }
+	inline Vec toFloat(VecInt a) { return _mm_cvtepi32_ps(a); }
+	inline VecInt addInt(VecInt a, VecInt b) { return _mm_add_epi32(a, b); }
+	inline VecInt subInt(VecInt a, VecInt b) { return _mm_sub_epi32(a, b); }
+	inline VecInt andInt(VecInt a, VecInt b) { return _mm_and_si128(a, b); }
+	inline VecInt andNotInt(VecInt a, VecInt b) { return _mm_andnot_si128(a, b); }
+	inline VecInt equalInt(VecInt a, VecInt b) { return _mm_cmpeq_epi32(a, b); }
+	template <int bits> inline VecInt shiftLeft(VecInt a) { return _mm_slli_epi32(a, bits); }
+	template <int bits> inline VecInt shiftRight(VecInt a) { return _mm_srli_epi32(a, bits); }
+	inline Vec asFloat(VecInt a) { return _mm_castsi128_ps(a); }
+	inline VecInt asInt(Vec a) { return _mm_castps_si128(a); }
+
+	// SSE2 has no rounding instruction: truncate and correct values that were rounded up
+	inline Vec floor(Vec a)
+	{
+		Vec truncated = toFloat(toInt(a));
+		truncated = sub(truncated, bitAnd(lessThan(a, truncated), set(1.0f)));
+		// Keeping the sign of -0, which ceil relies on to turn 0 into 0 instead of -0
+		truncated = bitOr(truncated, bitAnd(a, set(-0.0f)));
+		// Floats this large are already whole numbers (and would overflow the conversion), like infinity and NaN
+		Vec large = notLessThan(bitAndNot(set(-0.0f), a), set(8388608.0f));
+		return select(large, truncated, a);
+	}
+#endif
+
+	inline Vec abs(Vec a) { return bitAndNot(set(-0.0f), a); }
+
+	/* Transcendental functions on a single vector */
+
+	// Calculates the sine and cosine at once, as they share the range reduction
+	inline void sinCos(Vec x, Vec* sinOut, Vec* cosOut)
+	{
+		Vec sinSign = bitAnd(x, set(-0.0f));
+		x = abs(x);
+
+		// Scaling by 4/pi and rounding to an even octant
+		VecInt j = toInt(mul(x, set(1.27323954473516f)));
+		j = andInt(addInt(j, setInt(1)), setInt(~1));
+		Vec y = toFloat(j);
+
+		// Extended precision modular arithmetic: x - y * pi/4
+		x = add(x, mul(y, set(-0.78515625f)));
+		x = add(x, mul(y, set(-2.4187564849853515625e-4f)));
+		x = add(x, mul(y, set(-3.77489497744594108e-8f)));
+
+		// Octant dependent signs and polynomial selection
+		Vec sinSwap = asFloat(shiftLeft<29>(andInt(j, setInt(4))));
+		Vec cosSwap = asFloat(shiftLeft<29>(andNotInt(subInt(j, setInt(2)), setInt(4))));
+		Vec usePolynomialTwo = asFloat(equalInt(andInt(j, setInt(2)), setInt(0)));
+		sinSign = bitXor(sinSign, sinSwap);
+
+		Vec z = mul(x, x);
+
+		// Cosine polynomial on [-pi/4, pi/4]
+		Vec p1 = set(2.443315711809948e-5f);
+		p1 = add(mul(p1, z), set(-1.388731625493765e-3f));
+		p1 = add(mul(p1, z), set(4.166664568298827e-2f));
+		p1 = mul(mul(p1, z), z);
+		p1 = sub(p1, mul(z, set(0.5f)));
+		p1 = add(p1, set(1.0f));
+
+		// Sine polynomial on [-pi/4, pi/4]
+		Vec p2 = set(-1.9515295891e-4f);
+		p2 = add(mul(p2, z), set(8.3321608736e-3f));
+		p2 = add(mul(p2, z), set(-1.6666654611e-1f));
+		p2 = add(mul(mul(p2, z), x), x);
+
+		*sinOut = bitXor(select(usePolynomialTwo, p1, p2), sinSign);
+		*cosOut = bitXor(select(usePolynomialTwo, p2, p1), cosSwap);
+	}
+
+	inline Vec exp(Vec x)
+	{
+		// The clamp only keeps the range reduction valid, the edges are set at the end
+		Vec overflow = lessThan(set(88.7228393554688f), x);
+		Vec invalid = unordered(x, x);
+		// Below log(FLT_MIN) 2^(n - 1) is 0, which flushes the results to 0 like denormals
+		x = min(x, set(88.7228393554688f));
+		x = max(x, set(-87.3365478515625f));
+
+		// exp(x) = 2^n * exp(g), with n = round(x / log(2))
+		Vec n = floor(add(mul(x, set(1.44269504088896341f)), set(0.5f)));
+		x = sub(x, mul(n, set(0.693359375f)));
+		x = sub(x, mul(n, set(-2.12194440e-4f)));
+
+		Vec z = mul(x, x);
+		Vec y = set(1.9875691500e-4f);
+		y = add(mul(y, x), set(1.3981999507e-3f));
+		y = add(mul(y, x), set(8.3334519073e-3f));
+		y = add(mul(y, x), set(4.1665795894e-2f));
+		y = add(mul(y, x), set(1.6666665459e-1f));
+		y = add(mul(y, x), set(5.0000001201e-1f));
+		y = add(add(mul(y, z), x), set(1.0f));
+
+		// Building 2^(n - 1) directly in the exponent bits, as 2^128 has none
+		Vec power = asFloat(shiftLeft<23>(addInt(toInt(n), setInt(0x7e))));
+		y = mul(y, power);
+		y = add(y, y);
+
+		// exp(x) is infinity above log(FLT_MAX), and NaN of NaN
+		y = select(overflow, y, set(std::numeric_limits<float>::infinity()));
+		return bitOr(y, invalid);
+	}
+
+	inline Vec log(Vec x)
+	{
+		// Negative numbers and NaN
+		Vec invalid = notLessEqual(set(0.0f), x);
+		Vec edge = bitOr(equal(x, set(0.0f)), equal(x, set(std::numeric_limits<float>::infinity())));
+
+		// Splitting into exponent and a mantissa in [0.5, 1)
+		x = max(x, asFloat(setInt(0x00800000)));
+		VecInt exponent = subInt(shiftRight<23>(asInt(x)), setInt(0x7f));
+		x = bitOr(bitAnd(x, asFloat(setInt(~0x7f800000))), set(0.5f));
+		Vec e = add(toFloat(exponent), set(1.0f));
+
+		// Moving the mantissa to [sqrt(1/2), sqrt(2))
+		Vec small = lessThan(x, set(0.707106781186547524f));
+		Vec tmp = bitAnd(x, small);
+		x = sub(x, set(1.0f));
+		e = sub(e, bitAnd(set(1.0f), small));
+		x = add(x, tmp);
+
+		Vec z = mul(x, x);
+		Vec y = set(7.0376836292e-2f);
+		y = add(mul(y, x), set(-1.1514610310e-1f));
+		y = add(mul(y, x), set(1.1676998740e-1f));
+		y = add(mul(y, x), set(-1.2420140846e-1f));
+		y = add(mul(y, x), set(1.4249322787e-1f));
+		y = add(mul(y, x), set(-1.6668057665e-1f));
+		y = add(mul(y, x), set(2.0000714765e-1f));
+		y = add(mul(y, x), set(-2.4999993993e-1f));
+		y = add(mul(y, x), set(3.3333331174e-1f));
+		y = mul(mul(y, x), z);
+
+		y = add(y, mul(e, set(-2.12194440e-4f)));
+		y = sub(y, mul(z, set(0.5f)));
+		x = add(add(x, y), mul(e, set(0.693359375f)));
+
+		// log(0) = -infinity and log(infinity) = infinity, which have the sign of the exponent.
+		// The log of a negative number or NaN is NaN.
+		x = select(edge, x, mul(e, set(std::numeric_limits<float>::infinity())));
+		return bitOr(x, invalid);
+	}
+
+	inline Vec atan(Vec x)
+	{
+		Vec sign = bitAnd(x, set(-0.0f));
+		x = abs(x);
+
+		// Range reduction to [0, tan(pi/8)]
+		Vec large = lessThan(set(2.414213562373095f), x);
+		Vec medium = bitAndNot(large, lessThan(set(0.4142135623730950f), x));
+		Vec offset = select(large, select(medium, set(0.0f), set(0.785398163397448f)), set(1.570796326794897f));
+		x = select(large, select(medium, x, div(sub(x, set(1.0f)), add(x, set(1.0f)))), div(set(-1.0f), x));
+
+		Vec z = mul(x, x);
+		Vec y = set(8.05374449538e-2f);
+		y = add(mul(y, z), set(-1.38776856032e-1f));
+		y = add(mul(y, z), set(1.99777106478e-1f));
+		y = add(mul(y, z), set(-3.33329491539e-1f));
+		y = add(mul(mul(y, z), x), x);
+
+		return bitXor(add(y, offset), sign);
+	}
+
+	inline Vec asin(Vec x)
+	{
+		Vec sign = bitAnd(x, set(-0.0f));
+		Vec a = abs(x);
+		Vec invalid = lessThan(set(1.0f), a);
+
+		// Near 1 using asin(a) = pi/2 - 2 asin(sqrt((1 - a) / 2))
+		Vec large = lessThan(set(0.5f), a);
+		Vec z = select(large, mul(a, a), mul(set(0.5f), sub(set(1.0f), a)));
+		Vec r = select(large, a, sqrt(z));
+
+		Vec y = set(4.2163199048e-2f);
+		y = add(mul(y, z), set(2.4181311049e-2f));
+		y = add(mul(y, z), set(4.5470025998e-2f));
+		y = add(mul(y, z), set(7.4953002686e-2f));
+		y = add(mul(y, z), set(1.6666752422e-1f));
+		y = add(mul(mul(y, z), r), r);
+
+		y = select(large, y, sub(set(1.570796326794897f), add(y, y)));
+		return bitOr(bitXor(y, sign), invalid);
+	}
+
+}
+
+namespace
+{
+	using simd::Vec;
+	using simd::WIDTH;
+	using simd::load;
+	using simd::store;
+
+	/* Looping over arrays */
+
+	// Applies the operation to every vector, handling the last partial vector through a padded copy
+	template <typename Operation>
+	inline void forEach(const float* a, float* out, size_t count, Operation operation)
+	{
+		size_t i = 0;
+		for (; i + WIDTH <= count; i += WIDTH)
+		{
+			store(out + i, operation(load(a + i)));
+		}
+		if (i < count)
+		{
+			float paddedIn[WIDTH] = {};
+			float paddedOut[WIDTH];
+			std::memcpy(paddedIn, a + i, (count - i) * sizeof(float));
+			store(paddedOut, operation(load(paddedIn)));
+			std::memcpy(out + i, paddedOut, (count - i) * sizeof(float));
+		}
+	}
+
+	template <typename Operation>
+	inline void forEach(const float* a, const float* b, float* out, size_t count, Operation operation)
+	{
+		size_t i = 0;
+		for (; i + WIDTH <= count; i += WIDTH)
+		{
+			store(out + i, operation(load(a + i), load(b + i)));
+		}
+		if (i < count)
+		{
+			float paddedA[WIDTH] = {};
+			float paddedB[WIDTH] = {};
+			float paddedOut[WIDTH];
+			std::memcpy(paddedA, a + i, (count - i) * sizeof(float));
+			std::memcpy(paddedB, b + i, (count - i) * sizeof(float));
+			store(paddedOut, operation(load(paddedA), load(paddedB)));
+			std::memcpy(out + i, paddedOut, (count - i) * sizeof(float));
+		}
+	}
+}
+
+unsigned int SimdMath::getWidth()
+{
+	return WIDTH;
+}
+
+const char* SimdMath::getInstructionSet()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#else
+	return "SSE2";
+#endif
+}
+
+void SimdMath::fill(float value, float* out, size_t count)
+{
+	simd::Vec v = simd::set(value);
+	size_t i = 0;
+	for (; i + WIDTH <= count; i += WIDTH)
+	{
+		store(out + i, v);
+	}
+	for (; i < count; i++)
+	{
+		out[i] = value;
+	}
+}
+
+void SimdMath::add(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b) { return simd::add(a, b); });
+}
+void SimdMath::subtract(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b) { return simd::sub(a, b); });
+}
+void SimdMath::multiply(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b) { return simd::mul(a, b); });
+}
+void SimdMath::divide(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b) { return simd::div(a, b); });
+}
+void SimdMath::negate(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::bitXor(a, simd::set(-0.0f)); });
+}
+void SimdMath::add(const float* a, float b, float* out, size_t count)
+{
+	simd::Vec v = simd::set(b);
+	forEach(a, out, count, [v](Vec a) { return simd::add(a, v); });
+}
+void SimdMath::subtract(const float* a, float b, float* out, size_t count)
+{
+	simd::Vec v = simd::set(b);
+	forEach(a, out, count, [v](Vec a) { return simd::sub(a, v); });
+}
+void SimdMath::subtract(float a, const float* b, float* out, size_t count)
+{
+	simd::Vec v = simd::set(a);
+	forEach(b, out, count, [v](Vec b) { return simd::sub(v, b); });
+}
+void SimdMath::multiply(const float* a, float b, float* out, size_t count)
+{
+	simd::Vec v = simd::set(b);
+	forEach(a, out, count, [v](Vec a) { return simd::mul(a, v); });
+}
+void SimdMath::divide(const float* a, float b, float* out, size_t count)
+{
+	simd::Vec v = simd::set(b);
+	forEach(a, out, count, [v](Vec a) { return simd::div(a, v); });
+}
+void SimdMath::divide(float a, const float* b, float* out, size_t count)
+{
+	simd::Vec v = simd::set(a);
+	forEach(b, out, count, [v](Vec b) { return simd::div(v, b); });
+}
+void SimdMath::multiplyAdd(const float* a, float value, float offset, float* out, size_t count)
+{
+	simd::Vec v = simd::set(value);
+	simd::Vec o = simd::set(offset);
+	forEach(a, out, count, [v, o](Vec a) { return simd::add(simd::mul(a, v), o); });
+}
+
+void SimdMath::sin(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { Vec s, c; simd::sinCos(a, &s, &c); return s; });
+}
+void SimdMath::cos(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { Vec s, c; simd::sinCos(a, &s, &c); return c; });
+}
+void SimdMath::tan(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { Vec s, c; simd::sinCos(a, &s, &c); return simd::div(s, c); });
+}
+void SimdMath::asin(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::asin(a); });
+}
+void SimdMath::acos(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::sub(simd::set(1.570796326794897f), simd::asin(a)); });
+}
+void SimdMath::atan(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::atan(a); });
+}
+void SimdMath::exp(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::exp(a); });
+}
+void SimdMath::pow(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b)
+	{
+		// a^b = e^(b log(a)), with a^0 = 1 as in the C library
+		Vec result = simd::exp(simd::mul(b, simd::log(a)));
+		return simd::select(simd::equal(b, simd::set(0.0f)), result, simd::set(1.0f));
+	});
+}
+void SimdMath::sqrt(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::sqrt(a); });
+}
+void SimdMath::abs(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::abs(a); });
+}
+void SimdMath::floor(const float* a, float* out, size_t count)
+{
+	forEach(a, out, count, [](Vec a) { return simd::floor(a); });
+}
+void SimdMath::ceil(const float* a, float* out, size_t count)
+{
+	// ceil(a) = -floor(-a)
+	forEach(a, out, count, [](Vec a) { return simd::bitXor(simd::floor(simd::bitXor(a, simd::set(-0.0f))), simd::set(-0.0f)); });
+}
+void SimdMath::min(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b) { return simd::min(a, b); });
+}
+void SimdMath::max(const float* a, const float* b, float* out, size_t count)
+{
+	forEach(a, b, out, count, [](Vec a, Vec b) { return simd::max(a, b); });
+}
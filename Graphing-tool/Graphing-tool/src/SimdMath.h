@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+// Math functions over arrays of floats, vectorized with AVX2 when the compiler targets it
+// (/arch:AVX2 or -mavx2) and with SSE2 otherwise.
+// The input and output arrays may be the same array.
+namespace SimdMath
+{
+	// Get the number of floats processed per instruction
+	unsigned int getWidth();
+	// Get the name of the instruction set in use
+	const char* getInstructionSet();
+
+	// Fill the output with a single value
+	void fill(float value, float* out, size_t count);
+
+	// Element-wise arithmetic
+	void add(const float* a, const float* b, float* out, size_t count);
+	void subtract(const float* a, const float* b, float* out, size_t count);
+	void multiply(const float* a, const float* b, float* out, size_t count);
+	void divide(const float* a, const float* b, float* out, size_t count);
+	void negate(const float* a, float* out, size_t count);
+	// Element-wise arithmetic with a single value for one of the operands
+	void add(const float* a, float b, float* out, size_t count);
+	void subtract(const float* a, float b, float* out, size_t count);
+	void subtract(float a, const float* b, float* out, size_t count);
+	void multiply(const float* a, float b, float* out, size_t count);
+	void divide(const float* a, float b, float* out, size_t count);
+	void divide(float a, const float* b, float* out, size_t count);
+	// out = a * value + offset
+	void multiplyAdd(const float* a, float value, float offset, float* out, size_t count);
+
+	// Element-wise functions, matching the functions available in the graph function
+	void sin(const float* a, float* out, size_t count);
+	void cos(const float* a, float* out, size_t count);
+	void tan(const float* a, float* out, size_t count);
+	void asin(const float* a, float* out, size_t count);
+	void acos(const float* a, float* out, size_t count);
+	void atan(const float* a, float* out, size_t count);
+	void exp(const float* a, float* out, size_t count);
+	// Like GLSL, the result is undefined for a negative base
+	void pow(const float* a, const float* b, float* out, size_t count);
+	void sqrt(const float* a, float* out, size_t count);
+	void abs(const float* a, float* out, size_t count);
+	void floor(const float* a, float* out, size_t count);
+	void ceil(const float* a, float* out, size_t count);
+	void min(const float* a, const float* b, float* out, size_t count);
+	void max(const float* a, const float* b, float* out, size_t count);
+}
@@ -0,0 +1,79 @@
+#include "SlotAtlas.h"
+
+#include <algorithm>
+
+SlotAtlas::SlotAtlas(int slotCount) : slotCount(slotCount)
+{
+	clear();
+}
+
+void SlotAtlas::validate(const std::vector<float>& values)
+{
+	if (values != this->values)
+	{
+		clear();
+		this->values = values;
+	}
+}
+
+void SlotAtlas::beginUse()
+{
+	useCount++;
+}
+
+int SlotAtlas::use(const Key& key)
+{
+	std::unordered_map<Key, Slot, KeyHash>::iterator found = slots.find(key);
+	if (found == slots.end())
+		return -1;
+	found->second.lastUsed = useCount;
+	return found->second.slot;
+}
+
+bool SlotAtlas::freeSlotsFor(size_t count)
+{
+	if (freeSlots.size() >= count)
+		return true;
+
+	// Blocks not used by this use, least recently used first
+	std::vector<std::pair<unsigned int, Key>> candidates;
+	for (const std::pair<const Key, Slot>& slot : slots)
+	{
+		if (slot.second.lastUsed != useCount)
+			candidates.push_back({ slot.second.lastUsed, slot.first });
+	}
+	if (freeSlots.size() + candidates.size() < count)
+		return false;
+
+	size_t evictions = count - freeSlots.size();
+	std::partial_sort(candidates.begin(), candidates.begin() + evictions, candidates.end(),
+		[](const std::pair<unsigned int, Key>& a, const std::pair<unsigned int, Key>& b) { return a.first < b.first; });
+	for (size_t i = 0; i < evictions; i++)
+	{
+		std::unordered_map<Key, Slot, KeyHash>::iterator slot = slots.find(candidates[i].second);
+		freeSlots.push_back(slot->second.slot);
+		slots.erase(slot);
+	}
+	return true;
+}
+
+int SlotAtlas::insert(const Key& key)
+{
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+	slots[key] = { slot, useCount };
+	return slot;
+}
+
+void SlotAtlas::clear()
+{
+	slots.clear();
+	freeSlots.clear();
+	for (int slot = slotCount - 1; slot >= 0; slot--)
+		freeSlots.push_back(slot);
+}
+
+size_t SlotAtlas::getCount() const
+{
+	return slots.size();
+}
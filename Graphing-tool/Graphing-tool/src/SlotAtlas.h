@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Slots of a GPU atlas of square blocks of samples, shared by the tiles of the tiled domain and the chunks of the level of detail.
+// A block is found by its x and z on a level, when the atlas is full the least recently used blocks are replaced.
+// Only the slots are kept here, the owner holds the buffer and calculates the samples of new blocks.
+class SlotAtlas
+{
+public:
+	// Block x and z on a level, what they count depends on the owner
+	struct Key
+	{
+		int x;
+		int z;
+		int level;
+
+		bool operator==(const Key& other) const
+		{
+			return x == other.x && z == other.z && level == other.level;
+		}
+	};
+
+	// Also used for sets of keys, like the chunks picked by an update
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			return ((size_t)(unsigned int)key.x * 73856093u) ^ ((size_t)(unsigned int)key.z * 19349663u) ^ ((size_t)(unsigned int)key.level * 83492791u);
+		}
+	};
+
+	explicit SlotAtlas(int slotCount);
+
+	// Drop every block if the values differ from the values the blocks were calculated with.
+	// The samples are calculated from GPU buffers, the values only tell whether the blocks are still valid.
+	void validate(const std::vector<float>& values);
+	// Start a new use of the atlas, the blocks it uses are never replaced during it
+	void beginUse();
+	// Get the slot of a block and mark it as used, or -1 if it is not in the atlas
+	int use(const Key& key);
+	// Free enough slots for count new blocks, replacing the least recently used blocks not used by this use
+	bool freeSlotsFor(size_t count);
+	// Give a new block a slot, freeSlotsFor has to have made room for it
+	int insert(const Key& key);
+
+	void clear();
+	size_t getCount() const;
+
+private:
+	struct Slot
+	{
+		int slot;
+		// Use the block was last used by
+		unsigned int lastUsed;
+	};
+
+	int slotCount;
+	std::vector<float> values;
+	std::unordered_map<Key, Slot, KeyHash> slots;
+	std::vector<int> freeSlots;
+	unsigned int useCount = 0;
+};
@@ -0,0 +1,105 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: nextIndex(0)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		// hardware_concurrency may return 0 if it is unknown
+		if (threadCount == 0)
+			threadCount = 1;
+	}
+
+	// The calling thread also works, so one less worker is needed
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	startCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int index, unsigned int thread)>& task)
+{
+	if (count == 0)
+		return;
+
+	// Not worth waking the workers for a single task
+	if (workers.empty() || count == 1)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			task(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		taskCount = count;
+		nextIndex = 0;
+		busyWorkers = (unsigned int)workers.size();
+		generation++;
+	}
+	startCondition.notify_all();
+
+	// The calling thread helps out as thread 0
+	runTasks(0);
+
+	// Waiting for the workers to finish their last tasks
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+	this->task = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned int thread)
+{
+	unsigned int seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			startCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+			if (stopping)
+				return;
+			seenGeneration = generation;
+		}
+
+		runTasks(thread);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+void ThreadPool::runTasks(unsigned int thread)
+{
+	while (true)
+	{
+		unsigned int index = nextIndex.fetch_add(1);
+		if (index >= taskCount)
+			return;
+		(*task)(index, thread);
+	}
+}
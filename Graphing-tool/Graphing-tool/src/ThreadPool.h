@@ -0,0 +1,50 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// A fixed set of worker threads that work together on one parallel loop at a time
+class ThreadPool
+{
+public:
+	// Creates the given number of threads (including the calling thread),
+	// or one per hardware thread if threadCount is 0
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	// Get the number of threads working on each loop, including the calling thread
+	unsigned int getThreadCount() const;
+
+	// Runs task(index, thread) for every index in [0, count) spread over all threads,
+	// and returns once every index has been processed.
+	// thread is in [0, getThreadCount()) and can be used to select per-thread scratch memory.
+	void parallelFor(unsigned int count, const std::function<void(unsigned int index, unsigned int thread)>& task);
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	// Wakes the workers when a new loop starts or the pool stops
+	std::condition_variable startCondition;
+	// Wakes the calling thread when all workers are done with the current loop
+	std::condition_variable doneCondition;
+
+	// The loop currently being run
+	const std::function<void(unsigned int, unsigned int)>* task = nullptr;
+	unsigned int taskCount = 0;
+	std::atomic<unsigned int> nextIndex;
+
+	// Incremented for every loop, so workers can tell a new loop has started
+	unsigned int generation = 0;
+	unsigned int busyWorkers = 0;
+	bool stopping = false;
+
+	void workerLoop(unsigned int thread);
+
+	// Take indices from the current loop until none are left
+	void runTasks(unsigned int thread);
+};
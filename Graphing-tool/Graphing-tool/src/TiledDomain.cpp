@@ -0,0 +1,241 @@
+#include "TiledDomain.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "HeightBuffer.h"
+
+// Division rounding towards negative infinity, so tiles left of the origin get negative indices
+static int floorDivide(int a, int b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+void TiledDomain::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled)
+		clear();
+}
+
+bool TiledDomain::isEnabled() const
+{
+	return enabled;
+}
+
+void TiledDomain::setFunction(const std::string& function)
+{
+	if (tileShader)
+		glDeleteProgram(tileShader->ID);
+	tileShader.reset();
+	this->function = function;
+	clear();
+}
+
+bool TiledDomain::calculate(const std::vector<float>& variables, unsigned int size, float scale, float graphWidth, glm::vec2 center, glm::uvec2 workgroupSize,
+	HeightBuffer& heightBuffer)
+{
+	// Other variable values make every tile out of date
+	tiles.validate(variables);
+
+	// Statistics of a calculation that falls back to the regular one
+	fallenBack = true;
+	evaluatedTiles = 0;
+	derivedTiles = 0;
+	reusedTiles = 0;
+
+	// The coarsest level whose spacing is not larger than the spacing of the grid, so the tiles never undersample it.
+	// If the grid needs more tiles than the atlas holds, coarser levels are tried.
+	float halfWidth = scale * graphWidth;
+	float gridSpacing = 2.0f * halfWidth / (float)(size - 1);
+	int gridLevel = (int)std::floor(std::log2(gridSpacing));
+	const int cells = TILE_SAMPLES - 1;
+	float spacing = 0.0f;
+	glm::ivec2 firstTile, lastTile, tileCount;
+	for (level = gridLevel; ; level++)
+	{
+		// Visible tiles, from the tile holding the first point to the tile holding the last one
+		spacing = std::ldexp(1.0f, level);
+		firstTile = glm::ivec2(floorDivide((int)std::floor((center.x - halfWidth) / spacing), cells),
+			floorDivide((int)std::floor((center.y - halfWidth) / spacing), cells));
+		lastTile = glm::ivec2(floorDivide((int)std::floor((center.x + halfWidth) / spacing), cells),
+			floorDivide((int)std::floor((center.y + halfWidth) / spacing), cells));
+		tileCount = lastTile - firstTile + 1;
+		visibleTiles = tileCount.x * tileCount.y;
+		if (visibleTiles <= (unsigned int)TILE_SLOTS || level == gridLevel + MAX_COARSER_LEVELS)
+			break;
+	}
+	coarserLevels = level - gridLevel;
+	if (visibleTiles > (unsigned int)TILE_SLOTS)
+		return false;
+
+	if (atlasBuffer == 0)
+	{
+		glCreateBuffers(1, &atlasBuffer);
+		glNamedBufferStorage(atlasBuffer, (size_t)TILE_SLOTS * TILE_SAMPLES * TILE_SAMPLES * sizeof(float), nullptr, 0);
+		glCreateBuffers(1, &recordBuffer);
+		glCreateBuffers(1, &lookupBuffer);
+	}
+
+	// Finding the visible tiles, and what the missing ones can copy from the adjacent levels
+	tiles.beginUse();
+	std::vector<int> lookup(visibleTiles);
+	std::vector<SlotAtlas::Key> missing;
+	std::vector<TileRecord> records;
+	for (int z = firstTile.y; z <= lastTile.y; z++)
+	{
+		for (int x = firstTile.x; x <= lastTile.x; x++)
+		{
+			int slot = tiles.use({ x, z, level });
+			lookup[(z - firstTile.y) * tileCount.x + x - firstTile.x] = slot;
+			if (slot >= 0)
+				continue;
+
+			TileRecord record;
+			record.originX = (float)(x * cells) * spacing;
+			record.originZ = (float)(z * cells) * spacing;
+			record.spacing = spacing;
+			record.slot = -1;
+			record.parentSlot = tiles.use({ floorDivide(x, 2), floorDivide(z, 2), level + 1 });
+			record.parentOffsetX = (x - floorDivide(x, 2) * 2) * cells / 2;
+			record.parentOffsetZ = (z - floorDivide(z, 2) * 2) * cells / 2;
+			record.padding = 0;
+			for (int child = 0; child < 4; child++)
+				record.children[child] = tiles.use({ x * 2 + child % 2, z * 2 + child / 2, level - 1 });
+			missing.push_back({ x, z, level });
+			records.push_back(record);
+		}
+	}
+
+	if (!tiles.freeSlotsFor(missing.size()))
+		return false;
+
+	reusedTiles = visibleTiles - (unsigned int)missing.size();
+	for (size_t i = 0; i < missing.size(); i++)
+	{
+		TileRecord& record = records[i];
+		record.slot = tiles.insert(missing[i]);
+		const SlotAtlas::Key& key = missing[i];
+		lookup[(key.z - firstTile.y) * tileCount.x + key.x - firstTile.x] = record.slot;
+
+		bool allChildren = record.children[0] >= 0 && record.children[1] >= 0 && record.children[2] >= 0 && record.children[3] >= 0;
+		if (allChildren)
+			derivedTiles++;
+		else
+			evaluatedTiles++;
+	}
+	totalEvaluatedTiles += evaluatedTiles;
+	totalReusedTiles += reusedTiles;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ATLAS_BINDING, atlasBuffer);
+
+	// Filling every missing tile at once, one tile per layer of the dispatch
+	if (!records.empty())
+	{
+		if (!tileShader)
+			tileShader.reset(new ComputeShader(function, "src/shaders/calculatorTileShader.shader", true, workgroupSize));
+
+		glNamedBufferData(recordBuffer, records.size() * sizeof(TileRecord), records.data(), GL_STREAM_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RECORD_BINDING, recordBuffer);
+
+		tileShader->use();
+		tileShader->dispatch(TILE_SAMPLES, TILE_SAMPLES, (unsigned int)records.size());
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// Resampling the grid from the tiles, into the next buffer of the ring (bound to the Heights binding)
+	fallenBack = false;
+	heightBuffer.next();
+	if (!resampleShader)
+		resampleShader.reset(new ComputeShader("src/shaders/tileResampleShader.shader", workgroupSize));
+
+	glNamedBufferData(lookupBuffer, lookup.size() * sizeof(int), lookup.data(), GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LOOKUP_BINDING, lookupBuffer);
+
+	resampleShader->use();
+	resampleShader->setFloat(Uniform::Scale, scale);
+	resampleShader->setFloat(Uniform::GraphWidth, graphWidth);
+	resampleShader->setInt(Uniform::Size, size);
+	resampleShader->setFloat(Uniform::Offset, 2.0f / (float)(size - 1));
+	resampleShader->setVector2(Uniform::Center, center);
+	resampleShader->setFloat(Uniform::Spacing, spacing);
+	resampleShader->setInt(Uniform::FirstTileX, firstTile.x);
+	resampleShader->setInt(Uniform::FirstTileZ, firstTile.y);
+	resampleShader->setInt(Uniform::TileCountX, tileCount.x);
+	resampleShader->setInt(Uniform::TileCountZ, tileCount.y);
+	resampleShader->dispatch(size, size);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	return true;
+}
+
+void TiledDomain::clear()
+{
+	tiles.clear();
+}
+
+void TiledDomain::destroy()
+{
+	if (tileShader)
+		glDeleteProgram(tileShader->ID);
+	if (resampleShader)
+		glDeleteProgram(resampleShader->ID);
+	tileShader.reset();
+	resampleShader.reset();
+	glDeleteBuffers(1, &atlasBuffer);
+	glDeleteBuffers(1, &recordBuffer);
+	glDeleteBuffers(1, &lookupBuffer);
+	atlasBuffer = 0;
+	recordBuffer = 0;
+	lookupBuffer = 0;
+	clear();
+}
+
+unsigned int TiledDomain::getVisibleTiles() const
+{
+	return visibleTiles;
+}
+
+unsigned int TiledDomain::getEvaluatedTiles() const
+{
+	return evaluatedTiles;
+}
+
+unsigned int TiledDomain::getDerivedTiles() const
+{
+	return derivedTiles;
+}
+
+unsigned int TiledDomain::getReusedTiles() const
+{
+	return reusedTiles;
+}
+
+unsigned int TiledDomain::getTotalEvaluatedTiles() const
+{
+	return totalEvaluatedTiles;
+}
+
+unsigned int TiledDomain::getTotalReusedTiles() const
+{
+	return totalReusedTiles;
+}
+
+int TiledDomain::getLevel() const
+{
+	return level;
+}
+
+int TiledDomain::getCoarserLevels() const
+{
+	return coarserLevels;
+}
+
+bool TiledDomain::hasFallenBack() const
+{
+	return fallenBack;
+}
+
+size_t TiledDomain::getTileCount() const
+{
+	return tiles.getCount();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ComputeShader.h"
+#include "HeightBuffer.h"
+#include "SlotAtlas.h"
+
+// Calculates the graph from square tiles of function values on power of two lattices, kept in a GPU atlas.
+// Panning only calculates the tiles that come into view, and zooming by a factor of two copies the samples
+// the tiles of the new level share with the tiles of the previous one. The grid is then resampled from the
+// tiles, interpolating bilinearly between their samples.
+class TiledDomain
+{
+public:
+	// Samples along each side of a tile, neighbouring tiles share their edge samples
+	static const int TILE_SAMPLES = 65;
+	// Tiles the atlas holds, the visible ones and those last visible, for panning and zooming back
+	static const int TILE_SLOTS = 2048;
+	// Levels the tiles may be coarser than the grid, when the grid needs more tiles than the atlas holds
+	static const int MAX_COARSER_LEVELS = 2;
+	// Binding points of the Tiles, TileRecords and TileLookup buffers in the tile shaders
+	static const unsigned int ATLAS_BINDING = 5;
+	static const unsigned int RECORD_BINDING = 6;
+	static const unsigned int LOOKUP_BINDING = 7;
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	// Set the function the tiles are calculated with, which drops every tile
+	void setFunction(const std::string& function);
+
+	// Calculate the heights of the grid into the next buffer of the height buffer.
+	// The function reads the variables from the Variables buffer, the tiles are dropped when the values change.
+	// Returns false, without moving to the next buffer, if the grid needs more tiles than the atlas holds, even on coarser levels.
+	bool calculate(const std::vector<float>& variables, unsigned int size, float scale, float graphWidth, glm::vec2 center, glm::uvec2 workgroupSize,
+		HeightBuffer& heightBuffer);
+
+	void clear();
+	void destroy();
+
+	// Instrumentation: tiles of the last calculation, and of all calculations so far
+	unsigned int getVisibleTiles() const;
+	unsigned int getEvaluatedTiles() const;
+	unsigned int getDerivedTiles() const;
+	unsigned int getReusedTiles() const;
+	unsigned int getTotalEvaluatedTiles() const;
+	unsigned int getTotalReusedTiles() const;
+	int getLevel() const;
+	// Levels the tiles of the last calculation were coarser than the grid, to fit in the atlas
+	int getCoarserLevels() const;
+	// Whether the last calculation did not fit in the atlas and has to be done without tiles
+	bool hasFallenBack() const;
+	size_t getTileCount() const;
+
+private:
+	// Layout of the TileRecord struct of the tile shader
+	struct TileRecord
+	{
+		float originX;
+		float originZ;
+		float spacing;
+		int slot;
+		int parentSlot;
+		int parentOffsetX;
+		int parentOffsetZ;
+		int padding;
+		int children[4];
+	};
+
+	bool enabled = false;
+	std::string function;
+
+	// Slots of the tiles, keyed by x and z in tiles from the origin on the lattice with a spacing of 2 to the power of level
+	SlotAtlas tiles = SlotAtlas(TILE_SLOTS);
+
+	// Compiled on the first calculation of a function
+	std::unique_ptr<ComputeShader> tileShader;
+	std::unique_ptr<ComputeShader> resampleShader;
+
+	unsigned int atlasBuffer = 0;
+	unsigned int recordBuffer = 0;
+	unsigned int lookupBuffer = 0;
+
+	unsigned int visibleTiles = 0;
+	unsigned int evaluatedTiles = 0;
+	unsigned int derivedTiles = 0;
+	unsigned int reusedTiles = 0;
+	unsigned int totalEvaluatedTiles = 0;
+	unsigned int totalReusedTiles = 0;
+	int level = 0;
+	int coarserLevels = 0;
+	bool fallenBack = false;
+};
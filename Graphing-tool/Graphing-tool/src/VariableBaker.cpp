@@ -0,0 +1,110 @@
+#include "VariableBaker.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+const double VariableBaker::BAKE_DELAY = 0.5;
+
+void VariableBaker::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (enabled)
+		failed = false;
+}
+
+bool VariableBaker::isEnabled() const
+{
+	return enabled;
+}
+
+bool VariableBaker::hasFailed() const
+{
+	return failed;
+}
+
+void VariableBaker::setFunction(const std::string& function)
+{
+	discard(shader);
+	discard(pending);
+	this->function = function;
+}
+
+void VariableBaker::update(const std::vector<float>& values, glm::uvec2 workgroupSize)
+{
+	double now = glfwGetTime();
+	if (!sameValues(values, lastValues))
+	{
+		lastValues = values;
+		lastChangeTime = now;
+	}
+
+	// Picking up a finished version, never waits with parallel compiling
+	if (pending && pending->isLinkComplete())
+	{
+		try
+		{
+			pending->finishLink(true);
+			discard(shader);
+			shader = std::move(pending);
+			shaderValues = pendingValues;
+			bakeCount++;
+		}
+		catch (const std::exception& e)
+		{
+			// Staying with the version that reads the buffer
+			std::cout << "Error: could not link the baked calculator shader.\n" << e.what() << std::endl;
+			discard(pending);
+			enabled = false;
+			failed = true;
+		}
+	}
+
+	if (!enabled || pending || values.empty() || now - lastChangeTime < BAKE_DELAY)
+		return;
+	if (shader && sameValues(shaderValues, values))
+		return;
+
+	std::vector<std::pair<unsigned int, float>> constants;
+	for (size_t variable = 0; variable < values.size(); variable++)
+	{
+		// Values without a literal are still read from the buffer
+		if (std::isfinite(values[variable]))
+			constants.push_back(std::make_pair((unsigned int)variable, values[variable]));
+	}
+
+	pending.reset(new ComputeShader(function, "src/shaders/calculatorComputeShader.shader", false, workgroupSize, true, constants));
+	pendingValues = values;
+}
+
+ComputeShader* VariableBaker::getShader(const std::vector<float>& values)
+{
+	if (!enabled || !shader || !sameValues(shaderValues, values))
+		return nullptr;
+	return shader.get();
+}
+
+bool VariableBaker::isCompiling() const
+{
+	return pending != nullptr;
+}
+
+unsigned int VariableBaker::getBakeCount() const
+{
+	return bakeCount;
+}
+
+bool VariableBaker::sameValues(const std::vector<float>& first, const std::vector<float>& second)
+{
+	return first.size() == second.size()
+		&& (first.empty() || std::memcmp(first.data(), second.data(), first.size() * sizeof(float)) == 0);
+}
+
+void VariableBaker::discard(std::unique_ptr<ComputeShader>& program)
+{
+	if (program)
+		glDeleteProgram(program->ID);
+	program.reset();
+}
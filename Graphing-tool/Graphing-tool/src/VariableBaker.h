@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ComputeShader.h"
+
+// Compiles a version of the calculator shader with the user variables baked in as constants,
+// once they stopped changing for a while, so the driver can fold them into the expression.
+// The version that reads the Variables buffer is used while a variable is being dragged and until the baked version is linked.
+class VariableBaker
+{
+public:
+	// Seconds the variables have to stay the same before they are baked
+	static const double BAKE_DELAY;
+
+	void setEnabled(bool enabled);
+	// Baking turns itself off when a baked version does not link
+	bool isEnabled() const;
+	// Whether baking was turned off because a baked version did not link
+	bool hasFailed() const;
+
+	// Set the function the calculator shader is compiled with, discarding the baked version of the previous one
+	void setFunction(const std::string& function);
+
+	// Call every frame with the values of the function's variables:
+	// starts baking settled variables in the background and picks up finished versions
+	void update(const std::vector<float>& values, glm::uvec2 workgroupSize);
+
+	// Get the baked shader if it was baked with exactly these values, otherwise nullptr
+	ComputeShader* getShader(const std::vector<float>& values);
+
+	bool isCompiling() const;
+	// Number of baked versions that were linked
+	unsigned int getBakeCount() const;
+
+private:
+	bool enabled = false;
+	bool failed = false;
+	std::string function;
+
+	std::unique_ptr<ComputeShader> shader;
+	std::unique_ptr<ComputeShader> pending;
+	std::vector<float> shaderValues;
+	std::vector<float> pendingValues;
+
+	std::vector<float> lastValues;
+	double lastChangeTime = 0.0;
+
+	unsigned int bakeCount = 0;
+
+	// Whether the values are bitwise the same, so a NaN does not look like a change every frame
+	static bool sameValues(const std::vector<float>& first, const std::vector<float>& second);
+	void discard(std::unique_ptr<ComputeShader>& program);
+};
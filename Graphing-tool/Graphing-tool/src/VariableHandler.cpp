@@ -11,76 +11,161 @@
 
 #include "imgui/imgui_stdlib.h"
 
+#include <algorithm>
+
+#include "Expression.h"
+
 
 void VariableHandler::drawVariableList()
 {
-	// Saving prvious values to other array for comparing to detect change
-	for (unsigned int i = 0; i < 6; i++)
+	for (size_t i = 0; i < values.size(); i++)
 	{
-		prevVariableValues[i] = variableValues[i];
+		// Draw a dragfloat area for every variable of the function
+		if (ImGui::DragFloat(names[i].c_str(), &values[i], 0.001f))
+		{
+			markDirty(i);
+		}
 	}
+}
 
-	for (unsigned int i = 0; i < 6; i++)
+void VariableHandler::setFunction(const std::string& function)
+{
+	std::vector<std::string> newNames;
+	try
 	{
-		// Check if the variable is included in the current graph
-		if (variableIncluded[i])
-		{
-			// Draw a dragfloat area for the included variable
-			ImGui::DragFloat(variableNames[i].c_str(), &(variableValues[i]), 0.001f);
-		}
+		Expression expression(function);
+		newNames = expression.getVariables();
+	}
+	catch (const ExpressionError&)
+	{
+		// An invalid function has no variables
+	}
+
+	// Remembering the current values before replacing them
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		previousValues[names[i]] = values[i];
+	}
+
+	names = newNames;
+	values.assign(names.size(), 0.0f);
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		std::map<std::string, float>::const_iterator previous = previousValues.find(names[i]);
+		if (previous != previousValues.end())
+			values[i] = previous->second;
+	}
+
+	// The whole layout changed, so everything is uploaded again
+	dirty.assign((names.size() + 31) / 32, 0);
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		markDirty(i);
 	}
 }
 
-void VariableHandler::setFunction(std::string& function)
+bool VariableHandler::setValue(const std::string& name, float value)
 {
-	// Removing all function as they may contain variable letters
-	std::string functionCopy(function);
-	removeFunctions(functionCopy);
+	std::vector<std::string>::const_iterator found = std::find(names.begin(), names.end(), name);
+	if (found == names.end())
+		return false;
 
-	// Found it? Then it must be included
-	for (unsigned int i = 0; i < 6; i++)
+	size_t variable = found - names.begin();
+	if (values[variable] != value)
 	{
-		// Check and set whether the variable is included in the current graph
-		variableIncluded[i] = (functionCopy.find(variableNames[i].c_str()) != std::string::npos);
+		values[variable] = value;
+		markDirty(variable);
 	}
+	return true;
 }
 
-bool VariableHandler::variableChanged()
+bool VariableHandler::variableChanged() const
 {
-	for (unsigned int i = 0; i < 6; i++)
+	for (uint32_t bits : dirty)
 	{
 		// If any changed, return true
-		if (prevVariableValues[i] != variableValues[i])
-		{
+		if (bits != 0)
 			return true;
-		}
 	}
 	// If none changed, return false
 	return false;
 }
 
-void VariableHandler::setVariables(AbstractShader* shader)
+bool VariableHandler::uploadVariables()
 {
-	// Activate shader program before updating uniforms
-	shader->use();
-
-	for (unsigned int i = 0; i < 6; i++)
+	// The buffer can not be empty, and only grows
+	if (buffer == 0 || capacity < values.size())
 	{
-		// Set each variable in the shader
-		shader->setFloat(variableNames[i].c_str(), variableValues[i]);
+		if (buffer == 0)
+			glCreateBuffers(1, &buffer);
+		capacity = std::max<size_t>(std::max<size_t>(values.size(), capacity * 2), 1);
+		glNamedBufferData(buffer, capacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, buffer);
+
+		// The new storage holds nothing yet
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			markDirty(i);
+		}
 	}
-}
 
-void VariableHandler::removeFunctions(std::string& function)
-{
-	// Removing all function definitions
-	for (unsigned int i = 0; i < 14; i++)
+	// Finding the range from the first to the last changed variable
+	size_t first = values.size();
+	size_t last = 0;
+	for (size_t word = 0; word < dirty.size(); word++)
 	{
-		size_t start_pos = function.find(functions[i]);
-		while (start_pos != std::string::npos)
+		if (dirty[word] == 0)
+			continue;
+		for (size_t bit = 0; bit < 32; bit++)
 		{
-			function.replace(start_pos, functions[i].length(), "");
-			start_pos = function.find(functions[i]);
+			if (dirty[word] & (1u << bit))
+			{
+				first = std::min(first, word * 32 + bit);
+				last = word * 32 + bit;
+			}
 		}
 	}
+	if (first == values.size())
+		return false;
+
+	// A single upload, the few unchanged variables in between are cheaper than several calls
+	size_t bytes = (last - first + 1) * sizeof(float);
+	glNamedBufferSubData(buffer, first * sizeof(float), bytes, &values[first]);
+	std::fill(dirty.begin(), dirty.end(), 0);
+
+	uploadCount++;
+	uploadedBytes += bytes;
+	return true;
+}
+
+void VariableHandler::destroy()
+{
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	capacity = 0;
+}
+
+const std::vector<std::string>& VariableHandler::getNames() const
+{
+	return names;
+}
+
+const std::vector<float>& VariableHandler::getValues() const
+{
+	return values;
+}
+
+unsigned int VariableHandler::getUploadCount() const
+{
+	return uploadCount;
+}
+
+size_t VariableHandler::getUploadedBytes() const
+{
+	return uploadedBytes;
+}
+
+void VariableHandler::markDirty(size_t variable)
+{
+	dirty[variable / 32] |= 1u << (variable % 32);
 }
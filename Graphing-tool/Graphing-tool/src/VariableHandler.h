@@ -1,49 +1,64 @@
 #pragma once
 
-#include "AbstractShader.h"
+#include <glad/glad.h>
 
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// The user variables of the current function: every name in the function that is not
+// a function, input or constant, found by parsing it.
+// The values are one contiguous array in the order of Expression::getVariables,
+// which is also how the calculator shader reads them from the Variables buffer.
+// Changed variables are marked in a bitmask, and only the changed range is uploaded.
 class VariableHandler
 {
 public:
+	// Binding point of the Variables buffer in the shaders
+	static const unsigned int BINDING = 3;
+
 	// Use ImGui to draw a list of inputs for the variables
 	void drawVariableList();
 
-	// Set a function. Uses the function to enable and disable variables.
-	void setFunction(std::string& function);
+	// Set a function, its variables replace the current ones.
+	// Variables that were used before keep their value, new ones start at 0.
+	void setFunction(const std::string& function);
+
+	// Set the value of the variable with the given name, returns false if the function has no such variable
+	bool setValue(const std::string& name, float value);
+
+	// Get whether any variable has changed since the last upload
+	bool variableChanged() const;
 
-	// Get whether any variable has changed
-	bool variableChanged();
+	// Upload the changed variables into the Variables buffer and bind it,
+	// returns whether any variable changed since the last upload
+	bool uploadVariables();
+	void destroy();
 
-	// Apply the variables as uniforms in the given shader
-	void setVariables(AbstractShader* shader);
+	// Names and values of the variables of the current function, in the same order
+	const std::vector<std::string>& getNames() const;
+	const std::vector<float>& getValues() const;
 
-	float variableValues[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	// Instrumentation: uploads of changed variables and the bytes they uploaded
+	unsigned int getUploadCount() const;
+	size_t getUploadedBytes() const;
 
 private:
+	std::vector<std::string> names;
+	std::vector<float> values;
+	// One bit per variable, set when its value changed since the last upload
+	std::vector<uint32_t> dirty;
 
-	std::string functions[14] = {
-		"asin",
-		"acos",
-		"atan",
-		"sin",
-		"cos",
-		"tan",
-		"exp",
-		"pow",
-		"sqrt",
-		"abs",
-		"floor",
-		"ceil",
-		"min",
-		"max"
-	};
-
-	// Removes all function definitions from the given string
-	void removeFunctions(std::string& function);
-
-	// All variables and whether they are included
-	std::string variableNames[6] = { "a", "b", "c", "d", "e", "f" };
-	float prevVariableValues[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
-	bool variableIncluded[6] = { false, false, false, false, false, false };
-};
+	// Values of every variable used so far, so switching back to a function keeps them
+	std::map<std::string, float> previousValues;
+
+	unsigned int buffer = 0;
+	// Number of floats the buffer holds
+	size_t capacity = 0;
 
+	unsigned int uploadCount = 0;
+	size_t uploadedBytes = 0;
+
+	void markDirty(size_t variable);
+};
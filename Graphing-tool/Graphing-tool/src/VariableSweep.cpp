@@ -0,0 +1,210 @@
+#include "VariableSweep.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "HeightBuffer.h"
+
+void VariableSweep::setFunction(const std::string& function)
+{
+	if (shader)
+		glDeleteProgram(shader->ID);
+	shader.reset();
+	this->function = function;
+	invalidate();
+}
+
+void VariableSweep::setRange(const std::string& name, float from, float to)
+{
+	removeTrack(name);
+
+	Track track;
+	track.name = name;
+	track.keyframes.push_back({ 0.0f, from });
+	track.keyframes.push_back({ 1.0f, to });
+	tracks.push_back(track);
+	invalidate();
+}
+
+void VariableSweep::removeTrack(const std::string& name)
+{
+	tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [&](const Track& track) { return track.name == name; }), tracks.end());
+	invalidate();
+}
+
+VariableSweep::Track* VariableSweep::getTrack(const std::string& name)
+{
+	for (Track& track : tracks)
+	{
+		if (track.name == name)
+			return &track;
+	}
+	return nullptr;
+}
+
+void VariableSweep::setStepCount(unsigned int steps)
+{
+	stepCount = std::max(steps, 1u);
+	invalidate();
+}
+
+unsigned int VariableSweep::getStepCount() const
+{
+	return stepCount;
+}
+
+void VariableSweep::invalidate()
+{
+	calculated = false;
+}
+
+void VariableSweep::calculate(const std::vector<std::string>& names, const std::vector<float>& values,
+	unsigned int size, float scale, float graphWidth, glm::vec2 center, glm::uvec2 workgroupSize, CpuEvaluator* cpuEvaluator)
+{
+	// Layers start at the offset alignment, so every step can be bound on its own
+	int alignment = 4;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	size_t alignedFloats = std::max<size_t>(alignment / sizeof(float), 1);
+	layerStride = ((size_t)size * size + alignedFloats - 1) / alignedFloats * alignedFloats;
+
+	unsigned int steps = (unsigned int)std::min<size_t>(stepCount, MAX_STACK_BYTES / (layerStride * sizeof(float)));
+	if (steps < stepCount)
+		std::cout << "Sweep of " << stepCount << " steps does not fit in memory, calculating " << steps << std::endl;
+
+	// The values of all variables at every step, the first variable of a step right after the last one of the previous step
+	variableCount = names.size();
+	stepValues.assign(std::max<size_t>(steps * variableCount, 1), 0.0f);
+	for (unsigned int step = 0; step < steps; step++)
+	{
+		float position = steps > 1 ? (float)step / (float)(steps - 1) : 0.0f;
+		for (size_t variable = 0; variable < variableCount; variable++)
+		{
+			const Track* track = getTrack(names[variable]);
+			stepValues[step * variableCount + variable] = track ? evaluate(*track, position) : values[variable];
+		}
+	}
+
+	// Only allocating when the size of the stack changes
+	size_t bytes = steps * layerStride * sizeof(float);
+	if (stackBuffer == 0)
+	{
+		glCreateBuffers(1, &stackBuffer);
+		glCreateBuffers(1, &variableBuffer);
+	}
+	if (bytes != stackBytes)
+	{
+		glNamedBufferData(stackBuffer, bytes, nullptr, GL_DYNAMIC_COPY);
+		stackBytes = bytes;
+	}
+
+	if (cpuEvaluator != nullptr)
+	{
+		// Calculating step by step on the CPU, uploading every layer
+		std::vector<float> heights((size_t)size * size);
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			cpuEvaluator->calculate(heights.data(), size, scale, graphWidth, &stepValues[step * variableCount], center.x, center.y);
+			glNamedBufferSubData(stackBuffer, step * layerStride * sizeof(float), heights.size() * sizeof(float), heights.data());
+		}
+	}
+	else
+	{
+		if (!shader)
+			shader.reset(new ComputeShader(function, "src/shaders/calculatorSweepShader.shader", true, workgroupSize));
+
+		glNamedBufferData(variableBuffer, stepValues.size() * sizeof(float), stepValues.data(), GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, variableBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HeightBuffer::BINDING, stackBuffer);
+
+		shader->use();
+		shader->setFloat(Uniform::Scale, scale);
+		shader->setFloat(Uniform::GraphWidth, graphWidth);
+		shader->setInt(Uniform::Size, size);
+		shader->setFloat(Uniform::Offset, 2.0f / (float)(size - 1));
+		shader->setVector2(Uniform::Center, center);
+		shader->setInt(Uniform::LayerStride, (int)layerStride);
+
+		// Every step of the sweep at once
+		shader->dispatch(size, size, steps);
+		dispatchCount++;
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	calculated = true;
+	calculatedSize = size;
+	calculatedScale = scale;
+	calculatedGraphWidth = graphWidth;
+	calculatedCenter = center;
+	calculatedSteps = steps;
+}
+
+bool VariableSweep::isCalculated(unsigned int size, float scale, float graphWidth, glm::vec2 center) const
+{
+	return calculated && calculatedSteps > 0 && size == calculatedSize && scale == calculatedScale && graphWidth == calculatedGraphWidth
+		&& center == calculatedCenter;
+}
+
+unsigned int VariableSweep::getCalculatedSteps() const
+{
+	return calculatedSteps;
+}
+
+const float* VariableSweep::getStepValues(unsigned int step) const
+{
+	return &stepValues[std::min(step, calculatedSteps - 1) * variableCount];
+}
+
+void VariableSweep::bindStep(unsigned int step)
+{
+	if (calculatedSteps == 0)
+		return;
+	step = std::min(step, calculatedSteps - 1);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, HeightBuffer::BINDING, stackBuffer,
+		step * layerStride * sizeof(float), (size_t)calculatedSize * calculatedSize * sizeof(float));
+}
+
+size_t VariableSweep::getStackBytes() const
+{
+	return stackBytes;
+}
+
+unsigned int VariableSweep::getDispatchCount() const
+{
+	return dispatchCount;
+}
+
+void VariableSweep::destroy()
+{
+	if (shader)
+		glDeleteProgram(shader->ID);
+	shader.reset();
+	glDeleteBuffers(1, &stackBuffer);
+	glDeleteBuffers(1, &variableBuffer);
+	stackBuffer = 0;
+	variableBuffer = 0;
+	stackBytes = 0;
+	calculated = false;
+}
+
+float VariableSweep::evaluate(const Track& track, float position)
+{
+	if (track.keyframes.empty())
+		return 0.0f;
+
+	// The keyframes can be edited into any order
+	std::vector<Keyframe> keyframes = track.keyframes;
+	std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe& a, const Keyframe& b) { return a.position < b.position; });
+
+	if (position <= keyframes.front().position)
+		return keyframes.front().value;
+	for (size_t i = 1; i < keyframes.size(); i++)
+	{
+		if (position <= keyframes[i].position)
+		{
+			const Keyframe& previous = keyframes[i - 1];
+			float t = (position - previous.position) / (keyframes[i].position - previous.position);
+			return previous.value + (keyframes[i].value - previous.value) * t;
+		}
+	}
+	return keyframes.back().value;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ComputeShader.h"
+#include "CpuEvaluator.h"
+
+// Sweeps user variables over a number of steps, following keyframed curves,
+// and calculates the heights of every step into a stack of heightfields.
+// On the GPU the whole stack is a single 3D dispatch, with the step as the z coordinate.
+// Once calculated, any step can be drawn by binding its layer, so scrubbing and playing never calculate again.
+class VariableSweep
+{
+public:
+	// Binding point of the SweepVariables buffer in the sweep shader
+	static const unsigned int BINDING = 4;
+	// Most memory the stack may take, fewer steps are calculated beyond it
+	static const size_t MAX_STACK_BYTES = 512 * 1024 * 1024;
+
+	struct Keyframe
+	{
+		// From 0 at the first step to 1 at the last step
+		float position;
+		float value;
+	};
+
+	// The curve of one variable, linear between the keyframes and constant beyond the first and last
+	struct Track
+	{
+		std::string name;
+		std::vector<Keyframe> keyframes;
+	};
+
+	// Set the function the heights are calculated with, which invalidates the stack
+	void setFunction(const std::string& function);
+
+	// Sweep a variable linearly from one value to another, replacing its track
+	void setRange(const std::string& name, float from, float to);
+	void removeTrack(const std::string& name);
+	// Get the track of a variable, or nullptr if it is not swept. Call invalidate after changing it.
+	Track* getTrack(const std::string& name);
+
+	void setStepCount(unsigned int steps);
+	unsigned int getStepCount() const;
+
+	// Mark the stack as out of date, after changing tracks
+	void invalidate();
+
+	// Calculate every step into the stack, the variables that are not swept keep the given values.
+	// Calculates on the CPU with cpuEvaluator if it is not nullptr.
+	void calculate(const std::vector<std::string>& names, const std::vector<float>& values,
+		unsigned int size, float scale, float graphWidth, glm::vec2 center, glm::uvec2 workgroupSize, CpuEvaluator* cpuEvaluator);
+	// Whether the stack holds the steps of the current tracks for these settings
+	bool isCalculated(unsigned int size, float scale, float graphWidth, glm::vec2 center) const;
+
+	// Number of steps in the stack, may be less than the step count if the stack would be too large
+	unsigned int getCalculatedSteps() const;
+	// Get the values of the variables at a calculated step, in the order they were calculated with
+	const float* getStepValues(unsigned int step) const;
+
+	// Bind the heights of a calculated step to the Heights binding, in place of the height buffer
+	void bindStep(unsigned int step);
+
+	// Instrumentation: size of the stack and the dispatches of all sweeps so far
+	size_t getStackBytes() const;
+	unsigned int getDispatchCount() const;
+
+	void destroy();
+
+private:
+	std::string function;
+	std::vector<Track> tracks;
+	unsigned int stepCount = 100;
+
+	// Compiled on the first GPU sweep of a function
+	std::unique_ptr<ComputeShader> shader;
+
+	unsigned int stackBuffer = 0;
+	unsigned int variableBuffer = 0;
+	size_t stackBytes = 0;
+	// Heights from one layer to the next
+	size_t layerStride = 0;
+
+	// Settings the stack was calculated with
+	bool calculated = false;
+	unsigned int calculatedSize = 0;
+	float calculatedScale = 0.0f;
+	float calculatedGraphWidth = 0.0f;
+	glm::vec2 calculatedCenter = glm::vec2(0.0f);
+	unsigned int calculatedSteps = 0;
+	size_t variableCount = 0;
+	// The values of every variable at every step
+	std::vector<float> stepValues;
+
+	unsigned int dispatchCount = 0;
+
+	// Value of a track at a position between 0 and 1
+	static float evaluate(const Track& track, float position);
+};
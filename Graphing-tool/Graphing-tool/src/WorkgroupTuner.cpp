@@ -0,0 +1,139 @@
+#include "WorkgroupTuner.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "Expression.h"
+#include "VariableHandler.h"
+
+namespace
+{
+	// Deletes a shader program when it goes out of scope, also when something throws
+	struct ProgramGuard
+	{
+		unsigned int program;
+		~ProgramGuard() { glDeleteProgram(program); }
+	};
+}
+
+WorkgroupTuner::WorkgroupTuner(std::string function, unsigned int gridSize)
+	: gridSize(gridSize)
+{
+	const glm::uvec2 candidates[] = {
+		glm::uvec2(8, 8), glm::uvec2(16, 8), glm::uvec2(16, 16), glm::uvec2(32, 8),
+		glm::uvec2(32, 16), glm::uvec2(32, 32), glm::uvec2(64, 1), glm::uvec2(4, 4)
+	};
+
+	// Device limits for a single workgroup
+	int maxInvocations = 0, maxSizeX = 0, maxSizeY = 0;
+	glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSizeX);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxSizeY);
+
+	unsigned int ssbo = 0;
+	glGenBuffers(1, &ssbo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t)gridSize * gridSize * sizeof(float), 0, GL_DYNAMIC_COPY);
+
+	// The variables are all 0 while probing
+	size_t variableCount = 1;
+	try
+	{
+		variableCount = std::max<size_t>(Expression(function).getVariables().size(), 1);
+	}
+	catch (const ExpressionError&)
+	{
+		// An invalid function fails to compile for every size anyway
+	}
+	std::vector<float> variables(variableCount, 0.0f);
+	unsigned int variableBuffer = 0;
+	glGenBuffers(1, &variableBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, variableBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, variables.size() * sizeof(float), variables.data(), GL_STATIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VariableHandler::BINDING, variableBuffer);
+
+	float bestTime = -1.0f;
+	for (glm::uvec2 size : candidates)
+	{
+		if ((int)(size.x * size.y) > maxInvocations || (int)size.x > maxSizeX || (int)size.y > maxSizeY)
+			continue;
+
+		float time = measure(function, size, ssbo);
+		if (time < 0.0f)
+			continue;
+
+		results.push_back({ size, time });
+		if (bestTime < 0.0f || time < bestTime)
+		{
+			bestTime = time;
+			bestSize = size;
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glDeleteBuffers(1, &ssbo);
+	glDeleteBuffers(1, &variableBuffer);
+
+	std::cout << getReport() << std::endl;
+}
+
+glm::uvec2 WorkgroupTuner::getBestSize() const
+{
+	return bestSize;
+}
+
+std::string WorkgroupTuner::getReport() const
+{
+	std::stringstream report;
+	report << std::fixed << std::setprecision(3);
+	report << "Compute workgroup size: " << bestSize.x << "x" << bestSize.y;
+	for (const Result& result : results)
+	{
+		report << "\n  " << result.size.x << "x" << result.size.y << ": " << result.time << " ms on " << gridSize << "x" << gridSize;
+	}
+	return report.str();
+}
+
+float WorkgroupTuner::measure(std::string& function, glm::uvec2 size, unsigned int ssbo)
+{
+	const int runs = 5;
+
+	try
+	{
+		ComputeShader shader(function, "src/shaders/calculatorComputeShader.shader", true, size);
+		ProgramGuard guard{ shader.ID };
+		shader.use();
+		shader.setFloat(Uniform::Scale, 3.0f);
+		shader.setFloat(Uniform::GraphWidth, 1.0f);
+		shader.setInt(Uniform::Size, gridSize);
+		shader.setFloat(Uniform::Offset, 2.0f / (float)(gridSize - 1));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo);
+
+		// The first run includes driver work that only happens once
+		shader.dispatch(gridSize, gridSize);
+		glFinish();
+
+		unsigned int query = 0;
+		glGenQueries(1, &query);
+		float bestTime = -1.0f;
+		for (int i = 0; i < runs; i++)
+		{
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			shader.dispatch(gridSize, gridSize);
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			float time = (float)nanoseconds / 1000000.0f;
+			if (bestTime < 0.0f || time < bestTime)
+				bestTime = time;
+		}
+		glDeleteQueries(1, &query);
+		return bestTime;
+	}
+	catch (const std::exception&)
+	{
+		// A size the driver refuses to compile is skipped
+		return -1.0f;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ComputeShader.h"
+
+// Picks the fastest compute workgroup size for this device, by timing the calculator compute shader
+// with a few candidate sizes on a large grid. Only sizes within the device limits are tried.
+class WorkgroupTuner
+{
+public:
+	// Runs the probe, requires a current OpenGL 4.3 context
+	WorkgroupTuner(std::string function, unsigned int gridSize);
+
+	glm::uvec2 getBestSize() const;
+
+	// Get a readable summary of the probe: the time of every candidate and the chosen size
+	std::string getReport() const;
+
+private:
+	struct Result
+	{
+		glm::uvec2 size;
+		// GPU time of one calculation in milliseconds
+		float time;
+	};
+	std::vector<Result> results;
+	glm::uvec2 bestSize = glm::uvec2(8, 8);
+	unsigned int gridSize;
+
+	// Time the calculator with the given workgroup size, returns a negative time if it can not be used
+	float measure(std::string& function, glm::uvec2 size, unsigned int ssbo);
+};
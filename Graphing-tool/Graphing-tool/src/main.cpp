@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Application.h"
+#include "Benchmark.h"
+#include "HeadlessSettings.h"
 
 /* CONTROLS */
 /*
@@ -14,6 +16,12 @@
  - Mouse to look around
 */
 
+/* COMMAND LINE */
+/*
+ --benchmark	time the CPU calculation of the function on every quality level, without opening a window
+ --headless	render frames offscreen and write them to disk, run with --headless --help for the options
+*/
+
 // Window size
 const int WIDTH = 1200, HEIGHT = 900;
 
@@ -22,8 +30,31 @@ std::string function(
 	"sin(x*z)/1.4 + cos((x+z)/2)*a+b"
 );
 
-int main()
+int main(int argc, char* argv[])
 {
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		return runCpuBenchmark(function);
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--headless")
+	{
+		HeadlessSettings settings;
+		if (argc > 2 && std::string(argv[2]) == "--help")
+		{
+			printHeadlessUsage();
+			return 0;
+		}
+		if (!parseHeadlessSettings(argc, argv, 2, settings))
+		{
+			printHeadlessUsage();
+			return 1;
+		}
+
+		Application application(settings.width, settings.height, settings.function);
+		return application.RunHeadless(settings);
+	}
+
 	Application application(WIDTH, HEIGHT, function);
 	return application.Start();
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#version 460 core
+layout(local_size_x = $workgroupSizeX, local_size_y = $workgroupSizeY, local_size_z = 1) in;
+
+// Samples along each side of a chunk
+#define CHUNK_SAMPLES 65
+
+// Heights of all chunks, CHUNK_SAMPLES * CHUNK_SAMPLES each
+layout(std430, binding = 8) writeonly buffer ChunkHeights
+{
+	float chunkHeights[];
+};
+
+// A chunk to calculate, in graph coordinates from -1 to 1
+struct ChunkRecord
+{
+	vec2 origin;
+	float spacing;
+	int slot;
+};
+
+layout(std430, binding = 9) readonly buffer ChunkRecords
+{
+	ChunkRecord records[];
+};
+
+// User variables, in the order of the variables of the function
+layout(std430, binding = 3) readonly buffer Variables
+{
+	float variables[];
+};
+
+uniform float scale;
+uniform float graphWidth;
+// Point of the function at the middle of the graph
+uniform vec2 center;
+
+
+// Constants
+#define pi 3.14159265359
+#define epsilon 0.001
+
+void main()
+{
+	// Sample of the chunk, z is the chunk
+	int ix = int(gl_GlobalInvocationID.x);
+	int iz = int(gl_GlobalInvocationID.y);
+	ChunkRecord record = records[gl_GlobalInvocationID.z];
+
+	if (ix >= CHUNK_SAMPLES || iz >= CHUNK_SAMPLES)
+		return;
+
+	// Graph coordinates are exact on every level, so chunks of adjacent levels get the same heights on their shared points
+	vec2 position = record.origin + vec2(ix, iz) * record.spacing;
+	float x = center.x + position.x * scale * graphWidth;
+	float z = center.y + position.y * scale * graphWidth;
+
+	chunkHeights[record.slot * CHUNK_SAMPLES * CHUNK_SAMPLES + iz * CHUNK_SAMPLES + ix] = float($function) / scale;
+}
\ No newline at end of file
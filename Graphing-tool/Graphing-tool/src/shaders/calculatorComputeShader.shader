@@ -1,7 +1,7 @@
 #version 460 core
-layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+layout(local_size_x = $workgroupSizeX, local_size_y = $workgroupSizeY, local_size_z = 1) in;
 
-layout(std430, binding = 0) buffer Heights
+layout(std430, binding = 2) buffer Heights
 {
 	float heights[];
 };
@@ -10,14 +10,14 @@ uniform int size;
 uniform float offset;
 uniform float scale;
 uniform float graphWidth;
+// Point of the function at the middle of the graph
+uniform vec2 center;
 
-// User variables
-uniform float a;
-uniform float b;
-uniform float c;
-uniform float d;
-uniform float e;
-uniform float f;
+// User variables, in the order of the variables of the function
+layout(std430, binding = 3) readonly buffer Variables
+{
+	float variables[];
+};
 
 
 // Constants
@@ -31,9 +31,13 @@ void main()
 	int cx = int(gl_GlobalInvocationID.x);
 	int cz = int(gl_GlobalInvocationID.y);
 
+	// The last workgroups stick out of the grid if its size is not a multiple of the workgroup size
+	if (cx >= size || cz >= size)
+		return;
+
 	// Calculating world position from index
-	float x = (float(cx) * offset - 1.0) * scale * graphWidth;
-	float z = (float(cz) * offset - 1.0) * scale * graphWidth;
+	float x = center.x + (float(cx) * offset - 1.0) * scale * graphWidth;
+	float z = center.y + (float(cz) * offset - 1.0) * scale * graphWidth;
 
 	// Calculating the total index, used to map the 2D indices to a 1D array
 	int i = int(cx + size * cz);
@@ -1,9 +1,43 @@
 #version 460 core
 in vec4 vertexColor;
+// Grid coordinates of the fragment, whole numbers lie on the mesh edges
+in vec2 gridPosition;
 
 out vec4 FragColor;
 
+// Shading the mesh edges in this pass from the grid coordinates, instead of a second pass with lines
+uniform bool edges;
+// Filling the surface between the edges, without it only the edges are drawn
+uniform bool surface;
+
+// Edge width in pixels
+#define edgeWidth 1.0
+
 void main()
 {
-	FragColor = vertexColor;
-}
\ No newline at end of file
+	if (!edges)
+	{
+		FragColor = vertexColor;
+		return;
+	}
+
+	// Distance to the nearest grid line in x and z, and to the diagonal of the quad (from (0, 0) to (1, 1))
+	vec2 f = fract(gridPosition);
+	vec3 dist = vec3(min(f, 1.0 - f), abs(f.x - f.y));
+	// Screen space change of the same values, so the edges are equally wide at every distance
+	vec3 width = fwidth(vec3(gridPosition, gridPosition.x - gridPosition.y)) * edgeWidth;
+	vec3 edge = 1.0 - smoothstep(vec3(0.0), width, dist);
+	float e = max(max(edge.x, edge.y), edge.z);
+
+	// Edges are brighter than the surface, like the line pass
+	vec4 edgeColor = vec4(vertexColor.rgb * 1.2, 1.0);
+	if (!surface)
+	{
+		// Without blending, only keep the fragments that are mostly edge
+		if (e < 0.5)
+			discard;
+		FragColor = edgeColor;
+		return;
+	}
+	FragColor = mix(vertexColor, edgeColor, e);
+}
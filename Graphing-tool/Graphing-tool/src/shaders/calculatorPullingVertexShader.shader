@@ -0,0 +1,62 @@
+#version 460 core
+// Vertex pulling: no vertex or index buffers, the grid position follows from the vertex and instance IDs.
+// Every instance is a triangle strip over one row of quads, with 2 * size vertices.
+
+out vec4 vertexColor;
+// Grid coordinates for the edges in the fragment shader
+out vec2 gridPosition;
+
+// Buffer that holds the height of every point
+layout(std430, binding = 2) buffer Heights
+{
+	float heights[];
+};
+// Offset between each vertex
+uniform float offset;
+// Number of vertices in each dimension
+uniform int size;
+
+uniform bool edgeMode;
+
+uniform mat4 model;
+
+// Per-frame data shared by all programs
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 upperColor;
+	vec4 lowerColor;
+	float graphWidth;
+	float verticalScale;
+};
+
+void main()
+{
+	// Alternating between the next and the current row, so the strip diagonals match the indexed mesh
+	int cx = gl_VertexID / 2;
+	int cz = gl_InstanceID + 1 - gl_VertexID % 2;
+
+	// Index calculated from the individual indices for x and z
+	int i = int(cx + size * cz);
+
+	// Position in [-1, 1], like the generated mesh
+	vec3 aPos = vec3(float(cx) * offset - 1.0, 0.0, float(cz) * offset - 1.0);
+
+	float y = heights[i] * verticalScale;
+	gridPosition = vec2(cx, cz);
+
+
+	gl_Position = projection * view * model * vec4(aPos.x * graphWidth, y, aPos.z * graphWidth, 1.0);
+	if (edgeMode)
+	{
+		float yt = (y + 1.0) / 2.0;
+		vertexColor = vec4(yt*1.2, 0.0, (1.0 - yt)*1.2, 1.);
+		vertexColor = vec4((yt * upperColor.rgb + (1-yt) * lowerColor.rgb) * 1.2, 1.);
+	}
+	else
+	{
+		float yt = (y + 1.0) / 2.0;
+		vertexColor = vec4((yt * upperColor.rgb + (1 - yt) * lowerColor.rgb), 1.);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#version 460 core
+layout(local_size_x = $workgroupSizeX, local_size_y = $workgroupSizeY, local_size_z = 1) in;
+
+// A stack of heightfields, one layer per step of the sweep
+layout(std430, binding = 2) writeonly buffer Heights
+{
+	float heights[];
+};
+
+// The values of the user variables of every step, one after another
+layout(std430, binding = 4) readonly buffer SweepVariables
+{
+	float sweepVariables[];
+};
+
+uniform int size;
+uniform float offset;
+uniform float scale;
+uniform float graphWidth;
+// Point of the function at the middle of the graph
+uniform vec2 center;
+// Number of heights from the start of one layer to the next, padded to the buffer offset alignment
+uniform int layerStride;
+
+
+// Constants
+#define pi 3.14159265359
+#define epsilon 0.001
+
+void main()
+{
+	// Calculating the 2 dimensional indices, z is the step of the sweep
+	int cx = int(gl_GlobalInvocationID.x);
+	int cz = int(gl_GlobalInvocationID.y);
+	int step = int(gl_GlobalInvocationID.z);
+
+	// The last workgroups stick out of the grid if its size is not a multiple of the workgroup size
+	if (cx >= size || cz >= size)
+		return;
+
+	// The function reads the variables of this step
+	float variables[$variableCount];
+	for (int v = 0; v < $variableCount; v++)
+		variables[v] = sweepVariables[step * $variableCount + v];
+
+	// Calculating world position from index
+	float x = center.x + (float(cx) * offset - 1.0) * scale * graphWidth;
+	float z = center.y + (float(cz) * offset - 1.0) * scale * graphWidth;
+
+	// Calculating the total index, used to map the 2D indices to a 1D array
+	int i = int(cx + size * cz);
+
+	// Assigning the value
+	float height = float($function) / scale;
+	heights[step * layerStride + i] = height;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#version 460 core
+layout(local_size_x = $workgroupSizeX, local_size_y = $workgroupSizeY, local_size_z = 1) in;
+
+// Samples along each side of a tile
+#define TILE_SAMPLES 65
+#define HALF_TILE 32
+
+// All tiles, TILE_SAMPLES * TILE_SAMPLES function values each
+layout(std430, binding = 5) buffer Tiles
+{
+	float tiles[];
+};
+
+// A tile to fill, with the tiles of the adjacent levels that already hold some of its samples
+struct TileRecord
+{
+	vec2 origin;
+	float spacing;
+	int slot;
+	// Tile of the coarser level, or -1, and where this tile starts within it
+	int parentSlot;
+	int parentOffsetX;
+	int parentOffsetZ;
+	int padding;
+	// Tiles of the finer level covering each quarter, or -1
+	ivec4 children;
+};
+
+layout(std430, binding = 6) readonly buffer TileRecords
+{
+	TileRecord records[];
+};
+
+// User variables, in the order of the variables of the function
+layout(std430, binding = 3) readonly buffer Variables
+{
+	float variables[];
+};
+
+
+// Constants
+#define pi 3.14159265359
+#define epsilon 0.001
+
+void main()
+{
+	// Sample of the tile, z is the tile
+	int ix = int(gl_GlobalInvocationID.x);
+	int iz = int(gl_GlobalInvocationID.y);
+	TileRecord record = records[gl_GlobalInvocationID.z];
+
+	if (ix >= TILE_SAMPLES || iz >= TILE_SAMPLES)
+		return;
+
+	// Every sample is also a sample of the finer tile covering its quarter
+	int qx = min(ix / HALF_TILE, 1);
+	int qz = min(iz / HALF_TILE, 1);
+	int child = record.children[qz * 2 + qx];
+
+	float value;
+	if (child >= 0)
+	{
+		value = tiles[child * TILE_SAMPLES * TILE_SAMPLES + (iz - qz * HALF_TILE) * 2 * TILE_SAMPLES + (ix - qx * HALF_TILE) * 2];
+	}
+	// Every other sample is also a sample of the coarser tile
+	else if (record.parentSlot >= 0 && (ix & 1) == 0 && (iz & 1) == 0)
+	{
+		value = tiles[record.parentSlot * TILE_SAMPLES * TILE_SAMPLES + (record.parentOffsetZ + iz / 2) * TILE_SAMPLES + record.parentOffsetX + ix / 2];
+	}
+	else
+	{
+		// Position of the sample in function space
+		float x = record.origin.x + float(ix) * record.spacing;
+		float z = record.origin.y + float(iz) * record.spacing;
+		value = float($function);
+	}
+	tiles[record.slot * TILE_SAMPLES * TILE_SAMPLES + iz * TILE_SAMPLES + ix] = value;
+}
\ No newline at end of file
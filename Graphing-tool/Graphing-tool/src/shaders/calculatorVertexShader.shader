@@ -2,9 +2,11 @@
 layout(location = 0) in vec3 aPos;
 
 out vec4 vertexColor;
+// Grid coordinates for the edges in the fragment shader
+out vec2 gridPosition;
 
 // Buffer that holds the height of every point
-layout(std430, binding = 0) buffer Heights
+layout(std430, binding = 2) buffer Heights
 {
 	float heights[];
 };
@@ -16,14 +18,17 @@ uniform int size;
 uniform bool edgeMode;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
-uniform float graphWidth;
-uniform float verticalScale;
-
-uniform vec3 upperColor;
-uniform vec3 lowerColor;
+// Per-frame data shared by all programs
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 upperColor;
+	vec4 lowerColor;
+	float graphWidth;
+	float verticalScale;
+};
 
 #define epsilon 0.001
 
@@ -38,6 +43,7 @@ void main()
 	int i = int(cx + size * cz);
 
 	float y = heights[i] * verticalScale;
+	gridPosition = vec2(cx, cz);
 
 
 	gl_Position = projection * view * model * vec4(aPos.x * graphWidth, y, aPos.z * graphWidth, 1.0);
@@ -45,11 +51,11 @@ void main()
 	{
 		float yt = (y + 1.0) / 2.0;
 		vertexColor = vec4(yt*1.2, 0.0, (1.0 - yt)*1.2, 1.);
-		vertexColor = vec4((yt * upperColor + (1-yt) * lowerColor) * 1.2, 1.);
+		vertexColor = vec4((yt * upperColor.rgb + (1-yt) * lowerColor.rgb) * 1.2, 1.);
 	}
 	else
 	{
 		float yt = (y + 1.0) / 2.0;
-		vertexColor = vec4((yt * upperColor + (1 - yt) * lowerColor), 1.);
+		vertexColor = vec4((yt * upperColor.rgb + (1 - yt) * lowerColor.rgb), 1.);
 	}
 }
\ No newline at end of file
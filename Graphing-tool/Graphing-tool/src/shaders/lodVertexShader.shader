@@ -0,0 +1,84 @@
+#version 460 core
+// Adaptive level of detail: every instance is a chunk of the graph, every vertex a point of the chunk grid.
+// Points on the sides that border a coarser chunk lie halfway between two of its points, and take the height
+// halfway between them as well, so the sides of both chunks line up without cracks.
+
+out vec4 vertexColor;
+// Grid coordinates for the edges in the fragment shader
+out vec2 gridPosition;
+
+// Samples along each side of a chunk
+#define CHUNK_SAMPLES 65
+#define CHUNK_CELLS 64
+
+layout(std430, binding = 8) readonly buffer ChunkHeights
+{
+	float chunkHeights[];
+};
+
+// A chunk to draw, in graph coordinates from -1 to 1
+struct Chunk
+{
+	vec2 origin;
+	float spacing;
+	int slot;
+	// Sides bordering a coarser chunk: 1 is -x, 2 is +x, 4 is -z and 8 is +z
+	int coarserSides;
+	int padding[3];
+};
+
+layout(std430, binding = 10) readonly buffer Chunks
+{
+	Chunk chunks[];
+};
+
+uniform bool edgeMode;
+
+uniform mat4 model;
+
+// Per-frame data shared by all programs
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 upperColor;
+	vec4 lowerColor;
+	float graphWidth;
+	float verticalScale;
+};
+
+float chunkHeight(Chunk chunk, int cx, int cz)
+{
+	return chunkHeights[chunk.slot * CHUNK_SAMPLES * CHUNK_SAMPLES + cz * CHUNK_SAMPLES + cx];
+}
+
+void main()
+{
+	Chunk chunk = chunks[gl_InstanceID];
+	int cx = gl_VertexID % CHUNK_SAMPLES;
+	int cz = gl_VertexID / CHUNK_SAMPLES;
+
+	float height = chunkHeight(chunk, cx, cz);
+	bool stitchX = (cx == 0 && (chunk.coarserSides & 1) != 0) || (cx == CHUNK_CELLS && (chunk.coarserSides & 2) != 0);
+	bool stitchZ = (cz == 0 && (chunk.coarserSides & 4) != 0) || (cz == CHUNK_CELLS && (chunk.coarserSides & 8) != 0);
+	if (stitchX && cz % 2 == 1)
+		height = 0.5 * (chunkHeight(chunk, cx, cz - 1) + chunkHeight(chunk, cx, cz + 1));
+	else if (stitchZ && cx % 2 == 1)
+		height = 0.5 * (chunkHeight(chunk, cx - 1, cz) + chunkHeight(chunk, cx + 1, cz));
+
+	vec2 position = chunk.origin + vec2(cx, cz) * chunk.spacing;
+	float y = height * verticalScale;
+	gridPosition = vec2(cx, cz);
+
+
+	gl_Position = projection * view * model * vec4(position.x * graphWidth, y, position.y * graphWidth, 1.0);
+	float yt = (y + 1.0) / 2.0;
+	if (edgeMode)
+	{
+		vertexColor = vec4((yt * upperColor.rgb + (1 - yt) * lowerColor.rgb) * 1.2, 1.);
+	}
+	else
+	{
+		vertexColor = vec4((yt * upperColor.rgb + (1 - yt) * lowerColor.rgb), 1.);
+	}
+}
\ No newline at end of file
@@ -1,5 +1,5 @@
 #version 460 core
-layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+layout(local_size_x = $workgroupSizeX, local_size_y = $workgroupSizeY, local_size_z = 1) in;
 
 layout(std430, binding = 0) buffer Vertices
 {
@@ -12,6 +12,8 @@ layout(std430, binding = 1) buffer Indices
 };
 
 uniform int size;
+// Triangle strips with a restart index after every row, instead of a list of triangles
+uniform bool strips;
 
 uniform float offset;
 
@@ -21,6 +23,10 @@ void main()
 	int cx = int(gl_GlobalInvocationID.x);
 	int cy = int(gl_GlobalInvocationID.y);
 
+	// The last workgroups stick out of the grid if its size is not a multiple of the workgroup size
+	if (cx >= size || cy >= size)
+		return;
+
 	// Calculating the total index, used to map the 2D indices to a 1D array
 	int i = int(cx + size * cy);
 
@@ -28,6 +34,21 @@ void main()
 	vertices[i * 3 + 1] = 0.0;						// y
 	vertices[i * 3 + 2] = (cy * offset - 1.0);	// z
 
+	// Strip index generation: every row of quads is one strip of 2 * size indices and a restart index,
+	// alternating between the next and the current row of vertices
+	if (strips)
+	{
+		if (cy < size - 1)
+		{
+			int rowStart = cy * (2 * size + 1);
+			indices[rowStart + cx * 2] = cx + (cy + 1) * size;
+			indices[rowStart + cx * 2 + 1] = cx + cy * size;
+			if (cx == size - 1)
+				indices[rowStart + 2 * size] = 0xFFFFFFFFu;
+		}
+		return;
+	}
+
 	// Index generation
 	if (cx < size - 1 && cy < size - 1)
 	{
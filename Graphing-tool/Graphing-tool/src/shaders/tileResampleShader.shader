@@ -0,0 +1,70 @@
+#version 460 core
+layout(local_size_x = $workgroupSizeX, local_size_y = $workgroupSizeY, local_size_z = 1) in;
+
+// Samples along each side of a tile
+#define TILE_SAMPLES 65
+#define TILE_CELLS 64
+
+layout(std430, binding = 2) writeonly buffer Heights
+{
+	float heights[];
+};
+
+layout(std430, binding = 5) readonly buffer Tiles
+{
+	float tiles[];
+};
+
+// Slot of every visible tile, row by row
+layout(std430, binding = 7) readonly buffer TileLookup
+{
+	int lookup[];
+};
+
+uniform int size;
+uniform float offset;
+uniform float scale;
+uniform float graphWidth;
+uniform vec2 center;
+// Distance between the samples of the tiles
+uniform float spacing;
+// First visible tile and the number of visible tiles in a row and column
+uniform int firstTileX;
+uniform int firstTileZ;
+uniform int tileCountX;
+uniform int tileCountZ;
+
+float tileSample(int slot, ivec2 local)
+{
+	return tiles[slot * TILE_SAMPLES * TILE_SAMPLES + local.y * TILE_SAMPLES + local.x];
+}
+
+void main()
+{
+	int cx = int(gl_GlobalInvocationID.x);
+	int cz = int(gl_GlobalInvocationID.y);
+
+	// The last workgroups stick out of the grid if its size is not a multiple of the workgroup size
+	if (cx >= size || cz >= size)
+		return;
+
+	// Same world position as the calculator, in samples of the tile lattice
+	float x = center.x + (float(cx) * offset - 1.0) * scale * graphWidth;
+	float z = center.y + (float(cz) * offset - 1.0) * scale * graphWidth;
+	vec2 position = vec2(x, z) / spacing;
+	ivec2 firstTile = ivec2(firstTileX, firstTileZ);
+	ivec2 tileCount = ivec2(tileCountX, tileCountZ);
+
+	// The tile and the cell within it, rounding can put a point just outside the visible tiles
+	ivec2 cell = ivec2(floor(position));
+	ivec2 tile = clamp(ivec2(floor(vec2(cell) / float(TILE_CELLS))), firstTile, firstTile + tileCount - 1);
+	ivec2 local = clamp(cell - tile * TILE_CELLS, ivec2(0), ivec2(TILE_CELLS - 1));
+	vec2 t = clamp(position - vec2(tile * TILE_CELLS + local), 0.0, 1.0);
+
+	// Interpolating between the four samples around the point, which are always in the same tile
+	int slot = lookup[(tile.y - firstTile.y) * tileCount.x + tile.x - firstTile.x];
+	float top = mix(tileSample(slot, local), tileSample(slot, local + ivec2(1, 0)), t.x);
+	float bottom = mix(tileSample(slot, local + ivec2(0, 1)), tileSample(slot, local + ivec2(1, 1)), t.x);
+
+	heights[cx + size * cz] = mix(top, bottom, t.y) / scale;
+}
\ No newline at end of file
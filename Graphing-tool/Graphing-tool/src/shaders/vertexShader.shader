@@ -2,8 +2,17 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Per-frame data shared by all programs
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 upperColor;
+	vec4 lowerColor;
+	float graphWidth;
+	float verticalScale;
+};
 
 void main()
 {